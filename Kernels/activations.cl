@@ -16,6 +16,24 @@ __kernel void backpropTanh(__global float* _inputGrad, __global float* _input, _
 }
 
 
+/// Sigmoid
+__kernel void feedForwardSigmoid(__global float* _output, __global float* _input, int _inputWidth)
+{
+    const int index = get_global_id(0)*_inputWidth;
+
+    for (int k = 0; k < _inputWidth; k++)
+        _output[index + k] = 1.0f / (1.0f + exp(-_input[index + k]));
+}
+
+__kernel void backpropSigmoid(__global float* _inputGrad, __global float* _input, __global float* _output, __global float* _outputGrad, int _inputWidth)
+{
+    const int index = get_global_id(0)*_inputWidth;
+
+    for (int k = 0; k < _inputWidth; k++)
+        _inputGrad[index + k] = _output[index + k] * (1.0f - _output[index + k]) * _outputGrad[index + k];
+}
+
+
 /// ReLU
 __kernel void feedForwardReLU(__global float* _output, __global float* _input, int _inputWidth)
 {
@@ -30,7 +48,7 @@ __kernel void backpropReLU(__global float* _inputGrad, __global float* _input, _
     const int index = get_global_id(0)*_inputWidth;
 
     for (int k = 0; k < _inputWidth; k++)
-        _inputGrad[index + k] = step(0.0f, _input[index + k]) * _outputGrad[index + k];
+        _inputGrad[index + k] = _output[index + k] > 0.0f? _outputGrad[index + k]: 0.0f;
 }
 
 
@@ -0,0 +1,27 @@
+// All the parameters are updated in as few launches as possible: the kernel takes 8 tensors (Optimizer::TENSORS_PER_LAUNCH),
+// each with the end of its range in their concatenation. Unused slots repeat a tensor with an empty range
+#define TENSOR(n) __global float* _param##n, __global float* _paramGrad##n, __global float* _s##n, __global float* _r##n, int _end##n
+#define STEP(n, begin) if (i < _end##n) { step(_param##n, _paramGrad##n, _s##n, _r##n, i - (begin), _gradScale, _stepSize, _rho1, _rho2, _rCorrection, _delta); return; }
+
+void step(__global float* _param, __global float* _paramGrad, __global float* _s, __global float* _r, int i, float _gradScale, float _stepSize, float _rho1, float _rho2, float _rCorrection, float _delta)
+{
+    const float g = _gradScale * _paramGrad[i];
+
+    const float s = _rho1 * _s[i] + (1.0f-_rho1) * g;
+    const float r = _rho2 * _r[i] + (1.0f-_rho2) * g*g;
+
+    _s[i] = s;
+    _r[i] = r;
+
+    _param[i] -= (_stepSize * s) / (_delta + sqrt(r * _rCorrection));
+
+    _paramGrad[i] = 0.0f;
+}
+
+// _stepSize and _rCorrection include the bias corrections 1 / (1 - rho^t), computed once per step on the host
+__kernel void updateParams(float _gradScale, float _stepSize, float _rho1, float _rho2, float _rCorrection, float _delta, TENSOR(0), TENSOR(1), TENSOR(2), TENSOR(3), TENSOR(4), TENSOR(5), TENSOR(6), TENSOR(7))
+{
+    const int i = get_global_id(0);
+
+    STEP(0, 0) STEP(1, _end0) STEP(2, _end1) STEP(3, _end2) STEP(4, _end3) STEP(5, _end4) STEP(6, _end5) STEP(7, _end6)
+}
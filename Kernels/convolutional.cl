@@ -1,6 +1,8 @@
-__kernel void feedForwardConvolutional(__global float* _output, __global float* _input, __constant float* _kernel, __constant float* _bias, int _inputChannels, int _kernelWidth, int _kernelHeight, int _batch)
+// The first dimension of the global range runs over batch x outputChannels
+__kernel void feedForwardConvolutional(__global float* _output, __global float* _input, __constant float* _kernel, __constant float* _bias, int _inputChannels, int _kernelWidth, int _kernelHeight, int _outputChannels)
 {
-    const int tc = get_global_id(0);
+    const int batch = get_global_id(0) / _outputChannels;
+    const int tc = get_global_id(0) % _outputChannels;
     const int tx = get_global_id(1);
     const int ty = get_global_id(2);
 
@@ -11,7 +13,7 @@ __kernel void feedForwardConvolutional(__global float* _output, __global float*
     unsigned inputHeight = get_global_size(2)+mv;
 
     int biasIndex = tc * get_global_size(1)*get_global_size(2) + tx * get_global_size(2) + ty;
-    int outputIndex = _batch * get_global_size(0)*get_global_size(1)*get_global_size(2) + biasIndex;
+    int outputIndex = batch * _outputChannels*get_global_size(1)*get_global_size(2) + biasIndex;
 
 
     float value = 0.0f;
@@ -23,7 +25,7 @@ __kernel void feedForwardConvolutional(__global float* _output, __global float*
             for (int v = 0; v < _kernelHeight; ++v)
             {
                 float weight = _kernel[tc*_inputChannels*_kernelWidth*_kernelHeight + c*_kernelWidth*_kernelHeight + (mu-u)*_kernelHeight + (mv-v)];
-                float input = _input[_batch*_inputChannels*inputWidth*inputHeight + c*inputWidth*inputHeight + (tx+u)*inputHeight + (ty+v)];
+                float input = _input[batch*_inputChannels*inputWidth*inputHeight + c*inputWidth*inputHeight + (tx+u)*inputHeight + (ty+v)];
 
                 value += weight * input;
             }
@@ -33,9 +35,11 @@ __kernel void feedForwardConvolutional(__global float* _output, __global float*
     _output[outputIndex] = value + _bias[biasIndex];
 }
 
-__kernel void backpropConvolutional(__global float* _inputGrad, __global float* _outputGrad, __global float* _kernel, int _outputChannels, int _kernelWidth, int _kernelHeight, int _batch)
+// The first dimension of the global range runs over batch x inputChannels
+__kernel void backpropConvolutional(__global float* _inputGrad, __global float* _outputGrad, __global float* _kernel, int _outputChannels, int _kernelWidth, int _kernelHeight, int _inputChannels)
 {
-    const int tc = get_global_id(0);
+    const int batch = get_global_id(0) / _inputChannels;
+    const int tc = get_global_id(0) % _inputChannels;
     const int tx = get_global_id(1);
     const int ty = get_global_id(2);
 
@@ -45,8 +49,8 @@ __kernel void backpropConvolutional(__global float* _inputGrad, __global float*
     unsigned outputWidth = get_global_size(1)-mu;
     unsigned outputHeight = get_global_size(2)-mv;
 
-    int inputBatchIndex = _batch * get_global_size(0)*get_global_size(1)*get_global_size(2);
-    int outputBatchIndex = _batch * _outputChannels*outputWidth*outputHeight;
+    int inputBatchIndex = batch * _inputChannels*get_global_size(1)*get_global_size(2);
+    int outputBatchIndex = batch * _outputChannels*outputWidth*outputHeight;
 
     int inputIndex = inputBatchIndex + tc * get_global_size(1)*get_global_size(2) + tx * get_global_size(2) + ty;
 
@@ -64,7 +68,7 @@ __kernel void backpropConvolutional(__global float* _inputGrad, __global float*
             {
                 for (int c = 0; c < _outputChannels; ++c)
                 {
-                    float weight = _kernel[c*get_global_size(0)*_kernelWidth*_kernelHeight + tc*_kernelWidth*_kernelHeight + u*_kernelHeight + v];
+                    float weight = _kernel[c*_inputChannels*_kernelWidth*_kernelHeight + tc*_kernelWidth*_kernelHeight + u*_kernelHeight + v];
                     float outputGrad = _outputGrad[outputBatchIndex + c*outputWidth*outputHeight + i*outputHeight + j];
 
                     value += weight * outputGrad;
@@ -76,9 +80,11 @@ __kernel void backpropConvolutional(__global float* _inputGrad, __global float*
     _inputGrad[inputIndex] = value;
 }
 
-__kernel void weightsGradConvolutional(__global float* _weightsGrad, __global float* _outputGrad, __global float* _input, int _numBatches, int _outputChannels, int _outputWidth, int _outputHeight, int _outputChannel)
+// The first dimension of the global range runs over outputChannels x inputChannels
+__kernel void weightsGradConvolutional(__global float* _weightsGrad, __global float* _outputGrad, __global float* _input, int _numBatches, int _outputChannels, int _outputWidth, int _outputHeight, int _inputChannels)
 {
-    const int tc = get_global_id(0); // inputChannel
+    const int outputChannel = get_global_id(0) / _inputChannels;
+    const int tc = get_global_id(0) % _inputChannels; // inputChannel
     const int ti = get_global_id(1); // kernel width
     const int tj = get_global_id(2); // kernel height
 
@@ -88,13 +94,13 @@ __kernel void weightsGradConvolutional(__global float* _weightsGrad, __global fl
     unsigned shiftu = get_global_size(1)-1-ti;
     unsigned shiftv = get_global_size(2)-1-tj;
 
-    int chanOutIndex = _outputChannel * get_global_size(0)*get_global_size(1)*get_global_size(2);
+    int chanOutIndex = outputChannel * _inputChannels*get_global_size(1)*get_global_size(2);
     int chanInIndex = tc * get_global_size(1)*get_global_size(2);
 
     int outputGradBatchStride = _outputChannels*_outputWidth*_outputHeight;
-    int inputBatchStride = get_global_size(0)*inputWidth*inputHeight;
+    int inputBatchStride = _inputChannels*inputWidth*inputHeight;
 
-    int outputGradChannelIndex = _outputChannel * _outputWidth*_outputHeight;
+    int outputGradChannelIndex = outputChannel * _outputWidth*_outputHeight;
 
     float value = 0.0f;
 
@@ -130,3 +136,120 @@ __kernel void biasGradConvolutional(__global float* _biasGrad, __global float* _
 
     _biasGrad[biasIndex] += value;
 }
+
+
+/// Winograd F(2x2, 3x3)
+__kernel void winogradWeightsConvolutional(__global float* _U, __global float* _kernel)
+{
+    const int to = get_global_id(0);
+    const int tc = get_global_id(1);
+
+    const int inputChannels = get_global_size(1);
+    const int stride = get_global_size(0)*inputChannels;
+
+    // The layer computes a convolution while Winograd computes a correlation: kernels are flipped
+    float g[9];
+    for (int i = 0; i < 9; i++)
+        g[i] = _kernel[(to*inputChannels + tc)*9 + 8-i];
+
+    // U = G g G^T
+    float t[4][3];
+    for (int j = 0; j < 3; j++)
+    {
+        t[0][j] = g[j];
+        t[1][j] = 0.5f * (g[j] + g[3+j] + g[6+j]);
+        t[2][j] = 0.5f * (g[j] - g[3+j] + g[6+j]);
+        t[3][j] = g[6+j];
+    }
+
+    __global float* U = _U + to*inputChannels + tc;
+
+    for (int i = 0; i < 4; i++)
+    {
+        U[(4*i + 0) * stride] = t[i][0];
+        U[(4*i + 1) * stride] = 0.5f * (t[i][0] + t[i][1] + t[i][2]);
+        U[(4*i + 2) * stride] = 0.5f * (t[i][0] - t[i][1] + t[i][2]);
+        U[(4*i + 3) * stride] = t[i][2];
+    }
+}
+
+// The first dimension of the global range runs over batch x outputChannels
+__kernel void feedForwardWinograd(__global float* _output, __global float* _input, __global float* _U, __constant float* _bias, int _inputChannels, int _outputWidth, int _outputHeight, int _outputChannels)
+{
+    const int batch = get_global_id(0) / _outputChannels;
+    const int to = get_global_id(0) % _outputChannels;
+    const int tx = get_global_id(1); // tile coordinates
+    const int ty = get_global_id(2);
+
+    const int stride = _outputChannels*_inputChannels;
+
+    const int inputWidth = _outputWidth+2;
+    const int inputHeight = _outputHeight+2;
+
+    float m[16];
+    for (int k = 0; k < 16; k++)
+        m[k] = 0.0f;
+
+    for (int c = 0; c < _inputChannels; ++c)
+    {
+        __global float* image = _input + (batch*_inputChannels + c)*inputWidth*inputHeight;
+
+        // V = B^T d B
+        float d[4][4], t[4][4];
+
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                int x = 2*tx + i, y = 2*ty + j;
+                d[i][j] = (x < inputWidth && y < inputHeight)? image[x*inputHeight + y]: 0.0f;
+            }
+        }
+
+        for (int j = 0; j < 4; j++)
+        {
+            t[0][j] = d[0][j] - d[2][j];
+            t[1][j] = d[1][j] + d[2][j];
+            t[2][j] = d[2][j] - d[1][j];
+            t[3][j] = d[1][j] - d[3][j];
+        }
+
+        __global float* U = _U + to*_inputChannels + c;
+
+        for (int i = 0; i < 4; i++)
+        {
+            m[4*i + 0] += U[(4*i + 0) * stride] * (t[i][0] - t[i][2]);
+            m[4*i + 1] += U[(4*i + 1) * stride] * (t[i][1] + t[i][2]);
+            m[4*i + 2] += U[(4*i + 2) * stride] * (t[i][2] - t[i][1]);
+            m[4*i + 3] += U[(4*i + 3) * stride] * (t[i][1] - t[i][3]);
+        }
+    }
+
+    // Y = A^T m A
+    float t[2][4];
+    for (int j = 0; j < 4; j++)
+    {
+        t[0][j] = m[j] + m[4+j] + m[8+j];
+        t[1][j] = m[4+j] - m[8+j] - m[12+j];
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        int x = 2*tx + i;
+
+        float y[2];
+        y[0] = t[i][0] + t[i][1] + t[i][2];
+        y[1] = t[i][1] - t[i][2] - t[i][3];
+
+        for (int j = 0; j < 2; j++)
+        {
+            int yy = 2*ty + j;
+
+            if (x < _outputWidth && yy < _outputHeight)
+            {
+                int biasIndex = to*_outputWidth*_outputHeight + x*_outputHeight + yy;
+                _output[batch*_outputChannels*_outputWidth*_outputHeight + biasIndex] = y[j] + _bias[biasIndex];
+            }
+        }
+    }
+}
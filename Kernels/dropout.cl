@@ -1,15 +1,59 @@
-__kernel void feedForwardDropout(__global float* _output, __global float* _input, int _inputWidth, __global float* _rands, float rate)
+// Philox4x32-10, as in RNA/Maths/philox.h: 128 random bits from a counter and a key
+void philox(uint _counter[4], uint _key0, uint _key1)
 {
-    const int index = get_global_id(0)*_inputWidth;
+    for (int round = 0; round < 10; round++)
+    {
+        uint hi0 = mul_hi(0xD2511F53u, _counter[0]), lo0 = 0xD2511F53u * _counter[0];
+        uint hi1 = mul_hi(0xCD9E8D57u, _counter[2]), lo1 = 0xCD9E8D57u * _counter[2];
 
-    for (int k = 0; k < _inputWidth; k++)
-        _output[index + k] = _rands[index + k] < rate? 0.0f: _input[index + k];
+        uint c0 = hi1 ^ _counter[1] ^ _key0;
+        uint c2 = hi0 ^ _counter[3] ^ _key1;
+
+        _counter[0] = c0;
+        _counter[1] = lo1;
+        _counter[2] = c2;
+        _counter[3] = lo0;
+
+        _key0 += 0x9E3779B9u;
+        _key1 += 0xBB67AE85u;
+    }
+}
+
+// Inverted dropout: each work-item draws the mask of 32 consecutive units from the counter (index, run)
+// and stores it as one word, where set bits are the units that are kept
+__kernel void feedForwardDropout(__global float* _output, __global float* _input, __global uint* _mask, int _size, uint _key0, uint _key1, uint _run0, uint _run1, uint _threshold, float _scale)
+{
+    const int word = get_global_id(0);
+
+    uint bits = 0;
+
+    for (int k = 0; k < 8; k++)
+    {
+        uint r[4] = { (uint)(8*word + k), 0, _run0, _run1 };
+        philox(r, _key0, _key1);
+
+        for (int j = 0; j < 4; j++)
+        {
+            int i = 32*word + 4*k + j;
+            if (i >= _size)
+                break;
+
+            if (r[j] >= _threshold)
+            {
+                bits |= 1u << (4*k + j);
+                _output[i] = _scale * _input[i];
+            }
+            else
+                _output[i] = 0.0f;
+        }
+    }
+
+    _mask[word] = bits;
 }
 
-__kernel void backpropDropout(__global float* _inputGrad, __global float* _output, __global float* _outputGrad, int _inputWidth)
+__kernel void backpropDropout(__global float* _inputGrad, __global float* _outputGrad, __global uint* _mask, float _scale)
 {
-    const int index = get_global_id(0)*_inputWidth;
+    const int i = get_global_id(0);
 
-    for (int k = 0; k < _inputWidth; k++)
-        _inputGrad[index + k] = (_output[index + k] == 0.0f? 0.0f: 1.0f) * _outputGrad[index + k];
+    _inputGrad[i] = ((_mask[i / 32] >> (i % 32)) & 1u)? _scale * _outputGrad[i]: 0.0f;
 }
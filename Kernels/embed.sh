@@ -0,0 +1,22 @@
+#!/bin/sh
+# embed.sh Kernels src/RNA/kernelSources.inc : turns every kernel of a directory into a C string literal
+# The output is included by src/RNA/kernels.cpp, it is regenerated before each OpenCL build
+
+out="$2.tmp"
+
+echo "// Generated by Kernels/embed.sh, do not edit" > "$out"
+
+for file in "$1"/*.cl
+do
+    echo "{ \"$(basename "$file")\", \"\"" >> "$out"
+    sed -e 's/\r$//' -e 's/\\/\\\\/g' -e 's/"/\\"/g' -e 's/^.*$/"&\\n"/' "$file" >> "$out"
+    echo "}," >> "$out"
+done
+
+# Keep the previous file when nothing changed so that kernels.cpp is not rebuilt
+if cmp -s "$out" "$2"
+then
+    rm "$out"
+else
+    mv "$out" "$2"
+fi
@@ -1,52 +1,177 @@
-__kernel void feedForwardLinear(__global float* _output, __global float* _input, __global float* _weights, __global float* _bias, int _inputWidth)
+// Fused activations: 0 none, 1 tanh, 2 sigmoid, 3 ReLU, 4 ELU
+float activate(float _x, int _activation, float _alpha)
 {
-    const int tx = get_global_id(0);
-    const int ty = get_global_id(1);
+    switch (_activation)
+    {
+        case 1: return tanh(_x);
+        case 2: return 1.0f / (1.0f + exp(-_x));
+        case 3: return max(_x, 0.0f);
+        case 4: return _x < 0.0f? _alpha * (exp(_x)-1.0f): _x;
+        default: return _x;
+    }
+}
 
-    float value = 0.0f;
-    for (int k = 0; k < _inputWidth; ++k)
+// Derivative, from the activated value
+float activationDerivative(float _y, int _activation, float _alpha)
+{
+    switch (_activation)
     {
-        float weight = _weights[ty * _inputWidth + k];
-        float input = _input[tx * _inputWidth + k];
+        case 1: return 1.0f - _y*_y;
+        case 2: return _y * (1.0f - _y);
+        case 3: return _y > 0.0f? 1.0f: 0.0f;
+        case 4: return _y < 0.0f? _y + _alpha: 1.0f;
+        default: return 1.0f;
+    }
+}
 
-        value += weight * input;
+
+// Products of row-major matrices, tiled in local memory
+// Each work-item computes 4 consecutive results of one row, a work-group the block of get_local_size(0) rows and 4*get_local_size(1) columns
+// Any work-group shape works, so the runtime picks it within the limits of the kernel and the device (CL_KERNEL_WORK_GROUP_SIZE):
+// the slices of the reduction staged in local memory are as deep as TILE_FLOATS allows for that shape
+#ifndef TILE_FLOATS
+#define TILE_FLOATS 2048
+#endif
+
+// _row[_j.._j+3], zero past _width
+float4 loadRow4(__global const float* _row, int _j, int _width)
+{
+    if (_j + 4 <= _width)
+        return vload4(0, _row + _j);
+
+    return (float4)(_j < _width? _row[_j]: 0.0f, _j+1 < _width? _row[_j+1]: 0.0f, _j+2 < _width? _row[_j+2]: 0.0f, 0.0f);
+}
+
+void storeRow4(__global float* _row, int _j, int _width, float4 _value)
+{
+    if (_j + 4 <= _width)
+        vstore4(_value, 0, _row + _j);
+    else
+    {
+        if (_j < _width)   _row[_j] = _value.x;
+        if (_j+1 < _width) _row[_j+1] = _value.y;
+        if (_j+2 < _width) _row[_j+2] = _value.z;
     }
+}
 
-    _output[tx * get_global_size(1) + ty] = value + _bias[ty];
+float4 activate4(float4 _x, int _activation, float _alpha)
+{
+    return (float4)(activate(_x.x, _activation, _alpha), activate(_x.y, _activation, _alpha), activate(_x.z, _activation, _alpha), activate(_x.w, _activation, _alpha));
 }
 
-__kernel void backpropLinear(__global float* _inputGrad, __global float* _outputGrad, __global float* _weights, int _outputGradWidth)
+// An operand gives the value (r, k) of the result row or column r at the step k of the reduction: _matrix[r*_rStride + k*_kStride]
+// Stages the values r < _extent, k < _depth as _tile[k*_extent + r], zero from r = _rows on
+// The work-items of the group read consecutive values along the unit stride
+void stageTile(__local float* _tile, __global const float* _matrix, int _rStride, int _kStride, int _extent, int _depth, int _rows)
 {
-    const int tx = get_global_id(0);
-    const int ty = get_global_id(1);
+    const int items = get_local_size(0) * get_local_size(1);
 
-    float value = 0.0f;
-    for (int k = 0; k < _outputGradWidth; ++k)
+    for (int e = get_local_id(1) * get_local_size(0) + get_local_id(0); e < _extent * _depth; e += items)
     {
-        float weight = _weights[k * get_global_size(1) + ty];
-        float outputGrad = _outputGrad[tx * _outputGradWidth + k];
+        const int r = (_kStride == 1)? e / _depth: e % _extent;
+        const int k = (_kStride == 1)? e % _depth: e / _extent;
 
-        value += weight * outputGrad;
+        _tile[k*_extent + r] = (r < _rows)? _matrix[r*_rStride + k*_kStride]: 0.0f;
     }
-
-    _inputGrad[tx * get_global_size(1) + ty] = value;
 }
 
-__kernel void weightsGradLinear(__global float* _weightsGrad, __global float* _outputGrad, __global float* _input, int _numBatches)
+// Sum over the reduction of A(row, k) * B(column, k) for the 4 results of the work-item, the result being _rows x _columns
+float4 multiply(__global const float* _a, int _aRStride, int _aKStride, __global const float* _b, int _bRStride, int _bKStride,
+                int _rows, int _columns, int _depth, __local float* _aTile, __local float* _bTile)
 {
-    const int tx = get_global_id(0);
-    const int ty = get_global_id(1);
+    const int aExtent = get_local_size(0), bExtent = 4*get_local_size(1);
+    const int row = get_group_id(0) * aExtent, column = get_group_id(1) * bExtent;
+    const int i = get_local_id(0), j = 4*get_local_id(1);
 
-    float value = 0.0f;
-    for (int batch = 0; batch < _numBatches; batch++)
+    // Same for the whole work-group, as it only depends on its shape
+    const int slice = min(TILE_FLOATS / aExtent, TILE_FLOATS / bExtent);
+
+    float4 sum = 0.0f;
+
+    // Work-groups too wide for local memory read their operands directly
+    if (slice == 0)
     {
-        float outputGrad = _outputGrad[batch * get_global_size(0) + tx];
-        float input = _input[batch * get_global_size(1) + ty];
+        if (row + i >= _rows)
+            return sum;
+
+        __global const float* a = _a + (row + i) * _aRStride;
+        __global const float* b = _b + (column + j) * _bRStride;
+        const int c = _columns - (column + j);
+
+        for (int k = 0; k < _depth; k++)
+            sum += a[k*_aKStride] * (float4)(c > 0? b[k*_bKStride]: 0.0f, c > 1? b[_bRStride + k*_bKStride]: 0.0f,
+                                             c > 2? b[2*_bRStride + k*_bKStride]: 0.0f, c > 3? b[3*_bRStride + k*_bKStride]: 0.0f);
 
-        value += outputGrad * input;
+        return sum;
     }
 
-    _weightsGrad[tx * get_global_size(1) + ty] += value;
+    for (int k = 0; k < _depth; k += slice)
+    {
+        const int depth = min(slice, _depth - k);
+
+        stageTile(_aTile, _a + row*_aRStride + k*_aKStride, _aRStride, _aKStride, aExtent, depth, _rows - row);
+        stageTile(_bTile, _b + column*_bRStride + k*_bKStride, _bRStride, _bKStride, bExtent, depth, _columns - column);
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for (int s = 0; s < depth; s++)
+            sum += _aTile[s*aExtent + i] * vload4(0, _bTile + s*bExtent + j);
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    return sum;
+}
+
+// output = activation(input * weights^T + bias), over at least {batchSize, outputWidth/4}
+__kernel void feedForwardLinear(__global float* _output, __global float* _input, __global float* _weights, __global float* _bias, int _batchSize, int _inputWidth, int _outputWidth, int _activation, float _alpha)
+{
+    __local float inputTile[TILE_FLOATS];
+    __local float weightsTile[TILE_FLOATS];
+
+    const float4 sum = multiply(_input, _inputWidth, 1, _weights, _inputWidth, 1, _batchSize, _outputWidth, _inputWidth, inputTile, weightsTile);
+
+    const int i = get_global_id(0), j = 4*get_global_id(1);
+
+    if (i < _batchSize)
+        storeRow4(_output + i * _outputWidth, j, _outputWidth, activate4(sum + loadRow4(_bias, j, _outputWidth), _activation, _alpha));
+}
+
+__kernel void activationGradLinear(__global float* _activationGrad, __global float* _output, __global float* _outputGrad, int _activation, float _alpha)
+{
+    const int i = get_global_id(0);
+
+    _activationGrad[i] = activationDerivative(_output[i], _activation, _alpha) * _outputGrad[i];
+}
+
+// inputGrad = outputGrad * weights, over at least {batchSize, inputWidth/4}
+__kernel void backpropLinear(__global float* _inputGrad, __global float* _outputGrad, __global float* _weights, int _batchSize, int _inputWidth, int _outputWidth)
+{
+    __local float outputGradTile[TILE_FLOATS];
+    __local float weightsTile[TILE_FLOATS];
+
+    const float4 sum = multiply(_outputGrad, _outputWidth, 1, _weights, 1, _inputWidth, _batchSize, _inputWidth, _outputWidth, outputGradTile, weightsTile);
+
+    const int i = get_global_id(0), j = 4*get_global_id(1);
+
+    if (i < _batchSize)
+        storeRow4(_inputGrad + i * _inputWidth, j, _inputWidth, sum);
+}
+
+// weightsGrad += outputGrad^T * input, over at least {outputWidth, inputWidth/4}
+__kernel void weightsGradLinear(__global float* _weightsGrad, __global float* _outputGrad, __global float* _input, int _batchSize, int _inputWidth, int _outputWidth)
+{
+    __local float outputGradTile[TILE_FLOATS];
+    __local float inputTile[TILE_FLOATS];
+
+    const float4 sum = multiply(_outputGrad, 1, _outputWidth, _input, 1, _inputWidth, _outputWidth, _inputWidth, _batchSize, outputGradTile, inputTile);
+
+    const int i = get_global_id(0), j = 4*get_global_id(1);
+
+    if (i < _outputWidth)
+    {
+        __global float* weightsGrad = _weightsGrad + i * _inputWidth;
+        storeRow4(weightsGrad, j, _inputWidth, loadRow4(weightsGrad, j, _inputWidth) + sum);
+    }
 }
 
 __kernel void biasGradLinear(__global float* _biasGrad, __global float* _outputGrad, int _numBatches)
@@ -15,6 +15,28 @@ __kernel void gradientNLL(__global float* _output, __global float* _target, int
     _output[index*_inputWidth + (int)_target[index]] = -1.0f;
 }
 
+__kernel void gradientCrossEntropy(__global float* _output, __global float* _estimation, __global float* _target, int _inputWidth)
+{
+    const int start = get_global_id(0)*_inputWidth;
+
+    float maxLogit = _estimation[start];
+    for (int i = 1; i < _inputWidth; i++)
+        maxLogit = max(_estimation[start+i], maxLogit);
+
+    float sum = 0.0f;
+    for (int i = 0; i < _inputWidth; i++)
+    {
+        _output[start+i] = exp(_estimation[start+i] - maxLogit);
+        sum += _output[start+i];
+    }
+
+    const float invSum = 1.0f / sum;
+    for (int i = 0; i < _inputWidth; i++)
+        _output[start+i] *= invSum;
+
+    _output[start + (int)_target[get_global_id(0)]] -= 1.0f;
+}
+
 __kernel void gradientHuber(__global float* _output, __global float* _estimation, __global float* _target)
 {
     const int index = get_global_id(0)*get_global_size(1) + get_global_id(1);
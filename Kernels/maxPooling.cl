@@ -1,16 +1,14 @@
-__kernel void feedForwardMaxPooling(__global float* _output, __global float* _indices, __global float* _input, int _poolWidth, int _poolHeight, int _batch)
+// The first dimension of the global ranges runs over batch x channels, whose images are contiguous
+// _indices holds int32 positions in the input batch
+
+__kernel void feedForwardMaxPooling(__global float* _output, __global int* _indices, __global float* _input, int _poolWidth, int _poolHeight, int _inputWidth, int _inputHeight)
 {
     const int tc = get_global_id(0);
     const int tx = get_global_id(1);
     const int ty = get_global_id(2);
 
-    int inputBatchIndex = _batch * get_global_size(0) * _poolWidth*get_global_size(1) * _poolHeight*get_global_size(2);
-    int outputBatchIndex = _batch * get_global_size(0)*get_global_size(1)*get_global_size(2);
-
-    int inputChannelIndex = tc * _poolWidth*get_global_size(1) * _poolHeight*get_global_size(2);
-    int outputChannelIndex = tc * get_global_size(1)*get_global_size(2);
-
-    int outputIndex = outputBatchIndex + outputChannelIndex + tx * get_global_size(2) + ty;
+    int inputChannelIndex = tc * _inputWidth*_inputHeight;
+    int outputIndex = (tc * get_global_size(1) + tx) * get_global_size(2) + ty;
 
     float maxInput = -FLT_MAX;
     int maxIndex = -1;
@@ -19,7 +17,7 @@ __kernel void feedForwardMaxPooling(__global float* _output, __global float* _in
     {
         for (int j = 0 ; j < _poolHeight ; ++j)
         {
-            int inputIndex = inputBatchIndex + inputChannelIndex + (_poolWidth*tx+i) * _poolHeight*get_global_size(2) + (_poolHeight*ty+j);
+            int inputIndex = inputChannelIndex + (_poolWidth*tx+i) * _inputHeight + (_poolHeight*ty+j);
 
             if (_input[inputIndex] > maxInput)
             {
@@ -30,22 +28,30 @@ __kernel void feedForwardMaxPooling(__global float* _output, __global float* _in
     }
 
     _output[outputIndex] = maxInput;
-    _indices[outputIndex] = (float)maxIndex;
+    _indices[outputIndex] = maxIndex;
 }
 
-__kernel void backpropMaxPooling(__global float* _inputGrad, __global float* _outputGrad, __global float* _indices, int _numBatches)
+// Each input cell gathers from the output of its pooling window: every cell is written, no prior zeroing needed
+__kernel void backpropMaxPooling(__global float* _inputGrad, __global float* _outputGrad, __global int* _indices, int _poolWidth, int _poolHeight, int _outputWidth, int _outputHeight)
 {
     const int tc = get_global_id(0);
     const int tx = get_global_id(1);
     const int ty = get_global_id(2);
 
-    int colorChannel = tc * get_global_size(1)*get_global_size(2);
+    int inputIndex = (tc * get_global_size(1) + tx) * get_global_size(2) + ty;
 
-    for (int batch = 0; batch < _numBatches; ++batch)
+    int x = tx / _poolWidth;
+    int y = ty / _poolHeight;
+
+    float value = 0.0f;
+
+    if (x < _outputWidth && y < _outputHeight)
     {
-        int batchIndex = batch * get_global_size(0)*get_global_size(1)*get_global_size(2);
-        int outputIndex = batchIndex + colorChannel + tx * get_global_size(2) + ty;
+        int outputIndex = (tc * _outputWidth + x) * _outputHeight + y;
 
-        _inputGrad[(int)_indices[outputIndex]] = _outputGrad[outputIndex];
+        if (_indices[outputIndex] == inputIndex)
+            value = _outputGrad[outputIndex];
     }
+
+    _inputGrad[inputIndex] = value;
 }
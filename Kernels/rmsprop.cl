@@ -1,11 +1,23 @@
-__kernel void updateParam(__global float* _param, __global float* _paramGrad, __global float* _r, float _learningRate, float _rho, float _delta)
+// All the parameters are updated in as few launches as possible: the kernel takes 8 tensors (Optimizer::TENSORS_PER_LAUNCH),
+// each with the end of its range in their concatenation. Unused slots repeat a tensor with an empty range
+#define TENSOR(n) __global float* _param##n, __global float* _paramGrad##n, __global float* _r##n, int _end##n
+#define STEP(n, begin) if (i < _end##n) { step(_param##n, _paramGrad##n, _r##n, i - (begin), _gradScale, _learningRate, _rho, _delta); return; }
+
+void step(__global float* _param, __global float* _paramGrad, __global float* _r, int i, float _gradScale, float _learningRate, float _rho, float _delta)
 {
-    const int i = get_global_id(0);
+    const float g = _gradScale * _paramGrad[i];
 
-    _r[i] = _rho * _r[i] + (1.0f-_rho) * _paramGrad[i]* _paramGrad[i];
+    _r[i] = _rho * _r[i] + (1.0f-_rho) * g*g;
 
-    float delta = -(_learningRate * _paramGrad[i]) * rsqrt(_delta+_r[i]);
+    float delta = -(_learningRate * g) * rsqrt(_delta+_r[i]);
     _param[i] += delta;
 
     _paramGrad[i] = 0.0f;
 }
+
+__kernel void updateParams(float _gradScale, float _learningRate, float _rho, float _delta, TENSOR(0), TENSOR(1), TENSOR(2), TENSOR(3), TENSOR(4), TENSOR(5), TENSOR(6), TENSOR(7))
+{
+    const int i = get_global_id(0);
+
+    STEP(0, 0) STEP(1, _end0) STEP(2, _end1) STEP(3, _end2) STEP(4, _end3) STEP(5, _end4) STEP(6, _end5) STEP(7, _end6)
+}
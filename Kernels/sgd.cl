@@ -1,9 +1,19 @@
-__kernel void updateParam(__global float* _param, __global float* _paramGrad, __global float* _paramDelta, float _learningRate, float _inertia)
-{
-    const int i = get_global_id(0);
+// All the parameters are updated in as few launches as possible: the kernel takes 8 tensors (Optimizer::TENSORS_PER_LAUNCH),
+// each with the end of its range in their concatenation. Unused slots repeat a tensor with an empty range
+#define TENSOR(n) __global float* _param##n, __global float* _paramGrad##n, __global float* _paramDelta##n, int _end##n
+#define STEP(n, begin) if (i < _end##n) { step(_param##n, _paramGrad##n, _paramDelta##n, i - (begin), _gradScale, _learningRate, _inertia); return; }
 
-    _paramDelta[i] = _inertia * _paramDelta[i] - _learningRate * _paramGrad[i];
+void step(__global float* _param, __global float* _paramGrad, __global float* _paramDelta, int i, float _gradScale, float _learningRate, float _inertia)
+{
+    _paramDelta[i] = _inertia * _paramDelta[i] - _learningRate * _gradScale * _paramGrad[i];
     _param[i] += _paramDelta[i];
 
     _paramGrad[i] = 0.0f;
 }
+
+__kernel void updateParams(float _gradScale, float _learningRate, float _inertia, TENSOR(0), TENSOR(1), TENSOR(2), TENSOR(3), TENSOR(4), TENSOR(5), TENSOR(6), TENSOR(7))
+{
+    const int i = get_global_id(0);
+
+    STEP(0, 0) STEP(1, _end0) STEP(2, _end1) STEP(3, _end2) STEP(4, _end3) STEP(5, _end4) STEP(6, _end5) STEP(7, _end6)
+}
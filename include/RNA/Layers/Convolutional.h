@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Layer.h"
+#include "RNA/Maths/int8.h"
 
 namespace rna
 {
@@ -8,10 +9,20 @@ namespace rna
 class Convolutional: public Layer
 {
     public:
-        Convolutional(coords_t inputDimensions = {3, 32, 32}, coords_t kernelDimensions = {3, 3}, size_t _outputChannels = 3);
+        enum class Algorithm
+        {
+            DEFAULT,    // im2col + gemm on CPU, direct kernels on OpenCL
+            WINOGRAD,   // F(2x2, 3x3), for 3x3 kernels only
+            FFT,        // CPU only, for large kernels
+            INT8        // CPU only, inference: im2col + int8 gemm (see quantize)
+        };
+
+        Convolutional(coords_t inputDimensions = {3, 32, 32}, coords_t kernelDimensions = {3, 3}, size_t _outputChannels = 3,
+                      bool _randomize = true); // false leaves the parameters for a loader to fill
         Convolutional(std::ifstream& _file);
 
         void randomize();
+        void setAlgorithm(Algorithm _algorithm);
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
@@ -23,6 +34,12 @@ class Convolutional: public Layer
         void updateInputGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         void updateParamsGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        /// Runs feedForward on int8 weights (one scale per output channel) and int8 inputs clamped to [-_inputRange, _inputRange]
+        /// Backprop still uses single precision weights
+        void quantize(Tensor::value_type _inputRange);
+
+        virtual Layer* clone() const override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -30,15 +47,53 @@ class Convolutional: public Layer
 
         virtual void setParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad) override;
         virtual void getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad) override;
+        virtual void parametersChanged() override;
 
         virtual void saveToFile(std::ofstream& _file) const override;
 
+        #ifndef USE_OPENCL
+        /// Below this number of multiply-adds per sample, the direct loops are used instead of im2col + gemm
+        static const size_t DIRECT_CONVOLUTION_MAX_MACS;
+        #endif // USE_OPENCL
+
     private:
         Tensor weights, weightsGrad;
         Tensor bias, biasGrad;
 
+        Algorithm algorithm;
+
+        // Weights in the Winograd domain (16 x outputChannels x inputChannels),
+        // in the Fourier domain (outputChannels x inputChannels x rows x columns x 2) or in int8, recomputed after each update
+        Tensor transformedWeights;
+        bool transformedWeightsValid;
+
         #ifdef USE_OPENCL
         cl::Kernel weightsGradKernel, biasGradKernel;
+        cl::Kernel winogradWeightsKernel, winogradForwardKernel;
+        #else
+        bool useDirectConvolution() const;
+        void updateTransformedWeights();
+
+        void gemmForward(const Tensor& _input, size_t _batchSize);
+        void gemmWeightsGrad(const Tensor& _input, const Tensor& _outputGrad, size_t _batchSize);
+        void gemmInputGrad(const Tensor& _outputGrad, size_t _batchSize);
+
+        void winogradForward(const Tensor& _input, size_t _batchSize);
+        void winogradInputGrad(const Tensor& _outputGrad, size_t _batchSize);
+
+        void fftForward(const Tensor& _input, size_t _batchSize);
+        void fftBackprop(const Tensor& _input, const Tensor& _outputGrad, size_t _batchSize);
+
+        void int8Forward(const Tensor& _input, size_t _batchSize);
+
+        Tensor columns;
+        Tensor winogradWeightsT; // Transposed and unflipped, for inputGrad
+
+        std::vector<Tensor::value_type> workspace;
+
+        Int8Matrix int8Weights;
+        Tensor::value_type inputScale;
+        std::vector<uint8_t> int8Columns;
         #endif // USE_OPENCL
 };
 
@@ -2,6 +2,9 @@
 
 #include "Layer.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace rna
 {
 
@@ -11,12 +14,19 @@ class Dropout: public Layer
         Dropout(Tensor::value_type _rate = 0.5);
         Dropout(std::ifstream& _file);
 
+        virtual void setTraining(bool _training) override;
+
+        /// Replaces the random key of the generator and restarts from the first run, so that the masks can be reproduced
+        void setSeed(uint64_t _seed);
+
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
 
         virtual void feedForward(cl::CommandQueue&, const Tensor& _inputBatch);
         virtual void backprop(cl::CommandQueue&, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        virtual Layer* clone() const override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -25,8 +35,23 @@ class Dropout: public Layer
         virtual void saveToFile(std::ofstream& _file) const override;
 
     private:
+        void seed();
+
+        uint32_t threshold() const; // Units whose random number is below are dropped
+        Tensor::value_type scale() const; // Kept units are scaled so that inference is the identity
+
         Tensor::value_type rate;
-        Tensor rands;
+        bool training;
+
+        // Counter-based generator: the mask of a run only depends on the key and the run index
+        uint32_t key[2];
+        uint64_t run;
+
+        #ifdef USE_OPENCL
+        Tensor mask; // Only used as device storage for one bit per unit, see dropout.cl
+        #else
+        std::vector<uint32_t> mask; // One bit per unit, set for kept units
+        #endif // USE_OPENCL
 };
 
 }
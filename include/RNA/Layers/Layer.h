@@ -22,18 +22,32 @@ class Layer
 //        virtual void updateInputGrad(cl::CommandQueue&, const Tensor&, const Tensor&) {};
 //        virtual void updateParamsGrad(cl::CommandQueue&, const Tensor&, const Tensor&) {};
         #else
+        /// Copy with its own buffers, used for data-parallel training
+        /// Layers that do not implement it return nullptr and the trainers then run on a single thread
+        virtual Layer* clone() const;
+
+        // Let the Network provide the storage of the output and input gradient
+        void swapOutput(Tensor& _buffer);
+        void swapInputGrad(Tensor& _buffer);
+
         virtual void feedForward(const Tensor& _input) = 0;
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad) = 0;
         #endif // USE_OPENCL
 
 
-        const Tensor& getOutput() const;
-        const Tensor& getInputGrad() const;
+        virtual const Tensor& getOutput() const;
+        virtual const Tensor& getInputGrad() const; // Inside a Network on CPU with gradient sharing, only valid for the first layer after backprop
         const std::string& getType() const;
 
+        virtual void setBatchMode(bool) {}
+        virtual void setTraining(bool) {}
+
         virtual void setParams(std::vector<Tensor*>&, std::vector<Tensor*>&) {}
         virtual void getParams(std::vector<Tensor*>&, std::vector<Tensor*>&) {}
 
+        /// Called once the values of the parameters have been written from outside (snapshots): derived copies are out of date
+        virtual void parametersChanged() {}
+
         virtual void saveToFile(std::ofstream& _file) const;
 
 
@@ -1,17 +1,38 @@
 #pragma once
 
 #include "Layer.h"
+#include "RNA/Maths/bfloat16.h"
+#include "RNA/Maths/int8.h"
 
 namespace rna
 {
 
+class Activation;
+
 class Linear: public Layer
 {
     public:
-        Linear(size_t _inputSize, size_t _outputSize);
+        enum class Precision
+        {
+            SINGLE,
+            BFLOAT16,   // CPU only, inference: products read a bfloat16 copy of the weights and accumulate in single precision
+            INT8        // CPU only, inference: int8 weights and inputs (see quantize)
+        };
+
+        Linear(size_t _inputSize, size_t _outputSize, bool _randomize = true); // false leaves the parameters for a loader to fill
         Linear(std::ifstream& _file);
 
         void randomize();
+        void setPrecision(Precision _precision);
+
+        // Applies the activation to the output as it is computed, and its derivative in backprop
+        // The activation layer is not owned and is no longer run on its own (see Network::setFusion)
+        // On OpenCL, the kernels pick up the activation in openCL()
+        // getOutput then returns the activated values, the values before the activation are not kept
+        static bool canFuse(const Activation* _activation); // Whether the epilogue implements _activation on this backend
+        void setActivation(Activation* _activation);
+        Activation* getActivation() const;
+        const Tensor& getActivationGrad() const; // Gradient of the output before the activation
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
@@ -23,6 +44,14 @@ class Linear: public Layer
         void updateInputGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         void updateParamsGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        /// Runs feedForward on int8 weights (one scale per output) and int8 inputs clamped to [-_inputRange, _inputRange]
+        /// Only in inference mode: in training mode, feedForward and backprop use the single precision weights
+        void quantize(Tensor::value_type _inputRange);
+
+        virtual Layer* clone() const override;
+
+        virtual void setTraining(bool _training) override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -30,6 +59,7 @@ class Linear: public Layer
 
         virtual void setParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad) override;
         virtual void getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad) override;
+        virtual void parametersChanged() override;
 
         virtual void saveToFile(std::ofstream& _file) const override;
 
@@ -37,8 +67,25 @@ class Linear: public Layer
         Tensor weights, weightsGrad;
         Tensor bias, biasGrad;
 
+        Activation* activation;
+        Tensor activationGrad; // Gradient before the activation
+
+        Precision precision;
+        bool training; // Training always runs in single precision: the rounded copy would be rebuilt at every update
+
+        // Rounded copy of the weights (bfloat16 or int8), recomputed after each update
+        std::vector<bfloat16> halfWeights;
+        bool roundedWeightsValid;
+
         #ifdef USE_OPENCL
         cl::Kernel weightsGradKernel, biasGradKernel;
+        cl::Kernel activationGradKernel;
+        #else
+        void updateRoundedWeights();
+
+        Int8Matrix int8Weights;
+        Tensor::value_type inputScale;
+        std::vector<uint8_t> int8Input;
         #endif // USE_OPENCL
 };
 
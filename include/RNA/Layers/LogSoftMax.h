@@ -16,6 +16,8 @@ class LogSoftMax: public Layer
         virtual void feedForward(cl::CommandQueue&, const Tensor& _inputBatch);
         virtual void backprop(cl::CommandQueue&, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        virtual Layer* clone() const override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -17,6 +17,8 @@ class MaxPooling: public Layer
         virtual void feedForward(cl::CommandQueue&, const Tensor& _inputBatch);
         virtual void backprop(cl::CommandQueue&, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        virtual Layer* clone() const override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -27,7 +29,25 @@ class MaxPooling: public Layer
     private:
         size_t poolWidth, poolHeight;
 
-        Tensor indices; // TODO: indices should be array of size_t
+        #ifdef USE_OPENCL
+        /// int32 argmax of each output, written and read by the kernels of maxPooling.cl only
+        /// The storage is a float Tensor of the same size, so its elements are not exposed: read on the host they would be garbage
+        class DeviceIndices
+        {
+            public:
+                void resizeAs(const Tensor& _output, cl::Context& _context);
+                void setArg(cl::Kernel& _kernel, unsigned _index) const;
+
+                size_t size(size_t _dimension) const;
+
+            private:
+                Tensor storage;
+        };
+
+        DeviceIndices indices;
+        #else
+        std::vector<size_t> indices;
+        #endif // USE_OPENCL
 };
 
 }
@@ -11,7 +11,7 @@ class Reshape: public Layer
         Reshape(coords_t _dimensions = {}, bool _useMinibatch = false);
         Reshape(std::ifstream& _file);
 
-        void setBatchMode(bool _useMinibatch);
+        virtual void setBatchMode(bool _useMinibatch) override;
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
@@ -19,6 +19,8 @@ class Reshape: public Layer
         virtual void feedForward(cl::CommandQueue&, const Tensor& _inputBatch);
         virtual void backprop(cl::CommandQueue&, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        virtual Layer* clone() const override;
+
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
@@ -11,10 +11,21 @@ Tensor::value_type dSigmoid(Tensor::value_type _x);
 Tensor::value_type dtanh(Tensor::value_type _x);
 
 
+class Linear;
+
 class Activation: public Layer
 {
+    friend class Linear;
+
     public:
-        Activation(std::string _name): Layer(_name) {}
+        Activation(std::string _name): Layer(_name), fusedLayer(nullptr) {}
+        Activation(const Activation& _activation): Layer(_activation), fusedLayer(nullptr) {}
+
+        /// Once fused in a Linear layer, the activation is not run on its own:
+        /// its output and input gradient are the ones computed by the Linear layer
+        virtual const Tensor& getOutput() const override;
+        virtual const Tensor& getInputGrad() const override;
+        const Linear* getFusedLayer() const;
 
         #ifdef USE_OPENCL
         virtual void feedForward(cl::CommandQueue&, const Tensor& _inputBatch);
@@ -22,11 +33,14 @@ class Activation: public Layer
         #else
         virtual void feedForward(const Tensor& _input);
         virtual void backprop(const Tensor& _input, const Tensor& _outputGrad);
-        #endif // USE_OPENCL
 
+        // Applied to whole arrays, df being computed from the output
+        virtual void f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n) = 0;
+        virtual void df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n) = 0;
+        #endif // USE_OPENCL
 
-        virtual Tensor::value_type f(Tensor::value_type _value) = 0;
-        virtual Tensor::value_type df(Tensor::value_type _value) = 0;
+    private:
+        const Linear* fusedLayer;
 };
 
 
@@ -37,10 +51,27 @@ class Tanh: public Activation
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
+        #else
+        virtual Layer* clone() const override;
+
+        virtual void f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n) override;
+        virtual void df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n) override;
         #endif // USE_OPENCL
+};
+
+class Sigmoid: public Activation
+{
+    public:
+        Sigmoid(): Activation("Sigmoid") {}
 
-        virtual Tensor::value_type f(Tensor::value_type _value) override;
-        virtual Tensor::value_type df(Tensor::value_type _value) override;
+        #ifdef USE_OPENCL
+        virtual void openCL(cl::Context& _context);
+        #else
+        virtual Layer* clone() const override;
+
+        virtual void f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n) override;
+        virtual void df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n) override;
+        #endif // USE_OPENCL
 };
 
 class ReLU: public Activation
@@ -50,10 +81,12 @@ class ReLU: public Activation
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
-        #endif // USE_OPENCL
+        #else
+        virtual Layer* clone() const override;
 
-        virtual Tensor::value_type f(Tensor::value_type _value) override;
-        virtual Tensor::value_type df(Tensor::value_type _value) override;
+        virtual void f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n) override;
+        virtual void df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n) override;
+        #endif // USE_OPENCL
 };
 
 class ELU: public Activation
@@ -64,13 +97,17 @@ class ELU: public Activation
 
         #ifdef USE_OPENCL
         virtual void openCL(cl::Context& _context);
-        #endif // USE_OPENCL
+        #else
+        virtual Layer* clone() const override;
 
-        virtual Tensor::value_type f(Tensor::value_type _value) override;
-        virtual Tensor::value_type df(Tensor::value_type _value) override;
+        virtual void f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n) override;
+        virtual void df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n) override;
+        #endif // USE_OPENCL
 
         virtual void saveToFile(std::ofstream& _file) const override;
 
+        Tensor::value_type getAlpha() const;
+
     private:
         Tensor::value_type alpha;
 };
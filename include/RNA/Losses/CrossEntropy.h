@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Loss.h"
+
+namespace rna
+{
+
+/// LogSoftMax followed by NLL, computed from the logits
+/// The network must not end with a LogSoftMax layer: the gradient (softmax minus one-hot) is computed in one pass
+class CrossEntropy: public Loss
+{
+    public:
+        virtual Tensor::value_type getLoss(const Tensor& _estimation, const Tensor& _target) const;
+
+        #ifdef USE_OPENCL
+        virtual void openCL(cl::Context& _context);
+
+        virtual const Tensor& getGradient(cl::CommandQueue& _commandQueue, const Tensor& _estimationBatch, const Tensor& _targetBatch);
+        #else
+        virtual const Tensor& getGradient(const Tensor& _estimation, const Tensor& _target);
+        #endif // USE_OPENCL
+};
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+namespace rna
+{
+
+/// Element-wise activations over contiguous arrays, vectorized when the CPU supports it
+/// Derivatives are computed from the cached output, which allows applying the function in place
+
+void tanhForward(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n);
+void tanhBackward(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n);
+
+void sigmoidForward(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n);
+void sigmoidBackward(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n);
+
+void reluForward(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n);
+void reluBackward(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n);
+
+void eluForward(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n, Tensor::value_type _alpha);
+void eluBackward(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n, Tensor::value_type _alpha);
+
+}
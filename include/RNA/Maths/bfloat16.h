@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace rna
+{
+
+/// Brain floating point: the 16 upper bits of a float
+/// Same range as single precision with an 8 bits mantissa, so no loss scaling is needed
+using bfloat16 = uint16_t;
+
+inline Tensor::value_type toFloat(bfloat16 _value)
+{
+    uint32_t bits = uint32_t(_value) << 16;
+
+    Tensor::value_type value;
+    std::memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+// Rounds to nearest even
+inline bfloat16 toBFloat16(Tensor::value_type _value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &_value, sizeof(bits));
+
+    if ((bits & 0x7fffffff) > 0x7f800000) // Keep NaNs quiet instead of rounding them to infinity
+        return bfloat16((bits >> 16) | 0x0040);
+
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return bfloat16(bits >> 16);
+}
+
+void toBFloat16(bfloat16* _dst, const Tensor::value_type* _src, size_t _n);
+
+}
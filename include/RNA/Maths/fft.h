@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+#include <complex>
+
+namespace rna
+{
+
+using Complex = std::complex<Tensor::value_type>;
+
+size_t nextPowerOfTwo(size_t _n);
+
+/// In-place radix-2 FFT of a row-major rows x columns array (both powers of two)
+/// The inverse transform is normalized
+void fft2d(Complex* _data, size_t _rows, size_t _columns, bool _inverse);
+
+/// Zero-pads a real width x height plane to rows x columns and transforms it
+void realToSpectrum(Complex* _spectrum, const Tensor::value_type* _plane, size_t _width, size_t _height, size_t _rows, size_t _columns);
+
+/// _result[i] += a[i] * b[i] (or conj(a[i]) * b[i])
+void multiplyAccumulate(Complex* _result, const Complex* _a, const Complex* _b, size_t _n, bool _conjugateA = false);
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "RNA/Maths/bfloat16.h"
+
+#include <functional>
+
+namespace rna
+{
+
+/// Applied to each block of C as soon as it is final, while it is still in cache
+/// Arguments are the block, the leading dimension of C, the coordinates of the block in C and its size
+using GemmEpilogue = std::function<void(Tensor::value_type*, size_t, size_t, size_t, size_t, size_t)>;
+
+/// Row-major single precision GEMM: C = alpha * op(A) * op(B) + beta * C
+/// op(A) is m x k, op(B) is k x n and C is m x n
+/// When beta is 0, C is not read and may be uninitialized
+void gemm(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k,
+          Tensor::value_type _alpha, const Tensor::value_type* _A, size_t _lda,
+                                     const Tensor::value_type* _B, size_t _ldb,
+          Tensor::value_type _beta,        Tensor::value_type* _C, size_t _ldc,
+          const GemmEpilogue& _epilogue = nullptr);
+
+/// Same, with op(B) stored in bfloat16: values are widened when packed and accumulated in single precision
+void gemm(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k,
+          Tensor::value_type _alpha, const Tensor::value_type* _A, size_t _lda,
+                                     const bfloat16* _B, size_t _ldb,
+          Tensor::value_type _beta,        Tensor::value_type* _C, size_t _ldc,
+          const GemmEpilogue& _epilogue = nullptr);
+
+/// Sums the rows of a m x n matrix into _sums (accumulated)
+void addRows(Tensor::value_type* _sums, const Tensor::value_type* _A, size_t _m, size_t _n);
+
+/// Copies _row (n elements) into each row of a m x n matrix
+void broadcastRows(Tensor::value_type* _A, const Tensor::value_type* _row, size_t _m, size_t _n);
+
+}
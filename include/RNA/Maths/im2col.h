@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+namespace rna
+{
+
+/// Lowers a (channels x width x height) image to a (channels*kernelWidth*kernelHeight) x (outputWidth*outputHeight) matrix
+/// Rows are ordered like the weights of a Convolutional layer and kernels are flipped,
+/// so that multiplying the weights by this matrix gives the layer's (valid) convolution
+void im2col(Tensor::value_type* _columns, const Tensor::value_type* _image,
+            size_t _channels, size_t _width, size_t _height, size_t _kernelWidth, size_t _kernelHeight);
+
+/// Adjoint of im2col: accumulates each column entry back into the image cell it was read from
+/// The image is not cleared beforehand
+void col2im(Tensor::value_type* _image, const Tensor::value_type* _columns,
+            size_t _channels, size_t _width, size_t _height, size_t _kernelWidth, size_t _kernelHeight);
+
+}
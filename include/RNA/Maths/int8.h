@@ -0,0 +1,42 @@
+#pragma once
+
+#include "RNA/Maths/gemm.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace rna
+{
+
+/// Symmetric int8 quantization: x ~ scale * q, with q in [-127, 127]
+/// Activations are stored as q + 128 in uint8, weights as q in int8
+/// Rows are padded to a multiple of INT8_ALIGNMENT values so that kernels only work on full vectors
+const size_t INT8_ALIGNMENT = 32;
+
+size_t int8Stride(size_t _columns);
+
+// Quantizes a rows x columns matrix of activations into rows of _ldd values
+void quantizeRows(uint8_t* _dst, size_t _ldd, const Tensor::value_type* _src, size_t _rows, size_t _columns, Tensor::value_type _scale);
+
+// Same, storing the transpose: the result has _columns rows of _ldd values
+void quantizeColumns(uint8_t* _dst, size_t _ldd, const Tensor::value_type* _src, size_t _rows, size_t _columns, Tensor::value_type _scale);
+
+/// int8 copy of a weight matrix, with one scale per row (output channel)
+struct Int8Matrix
+{
+    void quantize(const Tensor::value_type* _src, size_t _rows, size_t _columns);
+
+    std::vector<int8_t> values;
+    std::vector<Tensor::value_type> scales;
+    std::vector<int32_t> sums; // Of each row, to remove the offset of the activations
+
+    size_t rows, columns, stride;
+};
+
+/// C = A * B^T, with A m x B.columns activations quantized with _scaleA (rows of B.stride values)
+/// Products are accumulated in int32, then rescaled and handed to the epilogue block by block
+void gemmInt8(size_t _m, const uint8_t* _A, Tensor::value_type _scaleA, const Int8Matrix& _B,
+              Tensor::value_type* _C, size_t _ldc,
+              const GemmEpilogue& _epilogue = nullptr);
+
+}
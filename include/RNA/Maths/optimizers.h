@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+namespace rna
+{
+
+/// Single pass parameter updates over contiguous arrays, vectorized when the CPU supports it
+/// Gradients are scaled by _gradScale on the fly and reset to zero
+
+void sgdStep(Tensor::value_type* _param, Tensor::value_type* _grad, Tensor::value_type* _delta, size_t _n,
+             Tensor::value_type _gradScale, Tensor::value_type _learningRate, Tensor::value_type _inertia);
+
+// _stepSize and _rCorrection include the bias corrections 1 / (1 - rho^t)
+void adamStep(Tensor::value_type* _param, Tensor::value_type* _grad, Tensor::value_type* _s, Tensor::value_type* _r, size_t _n,
+              Tensor::value_type _gradScale, Tensor::value_type _stepSize, Tensor::value_type _rho1, Tensor::value_type _rho2,
+              Tensor::value_type _rCorrection, Tensor::value_type _delta);
+
+void rmspropStep(Tensor::value_type* _param, Tensor::value_type* _grad, Tensor::value_type* _r, size_t _n,
+                 Tensor::value_type _gradScale, Tensor::value_type _learningRate, Tensor::value_type _rho, Tensor::value_type _delta);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rna
+{
+
+/// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+/// Turns a 128 bits counter into 128 random bits for a given key, in place, with no state to carry around
+/// Kernels/dropout.cl has the same function, so both backends draw the same numbers
+inline void philox(uint32_t _counter[4], const uint32_t _key[2])
+{
+    uint32_t k0 = _key[0], k1 = _key[1];
+
+    for (int round(0) ; round < 10 ; round++)
+    {
+        uint64_t product0 = uint64_t(0xD2511F53u) * _counter[0];
+        uint64_t product1 = uint64_t(0xCD9E8D57u) * _counter[2];
+
+        uint32_t c0 = uint32_t(product1 >> 32) ^ _counter[1] ^ k0;
+        uint32_t c2 = uint32_t(product0 >> 32) ^ _counter[3] ^ k1;
+
+        _counter[0] = c0;
+        _counter[1] = uint32_t(product1);
+        _counter[2] = c2;
+        _counter[3] = uint32_t(product0);
+
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+}
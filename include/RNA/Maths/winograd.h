@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Utility/Tensor.h"
+
+#include <vector>
+
+namespace rna
+{
+
+/// Winograd F(2x2, 3x3): each 2x2 output tile is computed from a 4x4 input tile
+/// with 16 multiplications per channel pair instead of 36
+
+/// Transforms a 3x3 correlation kernel g (row-major) into its 16 Winograd coefficients, written every _stride values
+void winogradKernel(Tensor::value_type* _U, size_t _stride, const Tensor::value_type* _g);
+
+/// Valid correlation of a batch of zero-padded images with 3x3 kernels given in the Winograd domain
+/// _input is batch x inputChannels x width x height
+/// _U is 16 x outputChannels x inputChannels (see winogradKernel)
+/// _output is batch x outputChannels x (width+2*padding-2) x (height+2*padding-2) and is overwritten
+void winogradCorrelate(Tensor::value_type* _output, const Tensor::value_type* _input, const Tensor::value_type* _U,
+                       size_t _batchSize, size_t _inputChannels, size_t _outputChannels,
+                       size_t _width, size_t _height, size_t _padding,
+                       std::vector<Tensor::value_type>& _workspace);
+
+}
@@ -8,6 +8,8 @@
 namespace rna
 {
 
+struct Example;
+
 class Network
 {
     public:
@@ -20,6 +22,12 @@ class Network
         void add(Layer* _layer);
         void clear();
 
+        /// Activations following a Linear layer are applied in its epilogue, when the backend implements them there (off by default)
+        /// The fused activation layer stays in the network but is not run, its getOutput and getInputGrad forward to the Linear layer
+        /// Fusion changes what the Linear layer exposes: getLayer(i)->getOutput() holds the activated values,
+        /// the values before the activation are not kept
+        void setFusion(bool _fuse);
+
         #ifdef USE_OPENCL
         void openCL(cl::DeviceType _deviceType = cl::DeviceType::ALL);
         void releaseCL();
@@ -30,7 +38,30 @@ class Network
         const Tensor& feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch);
         void backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch);
         #else
+        Network* clone() const; // Same layers and parameters, with separate buffers and gradients (nullptr if a layer can not be cloned)
+        void setBatchMode(bool _useMinibatch);
+
+        /// Inference mode: Dropout is disabled and the intermediate outputs share two buffers,
+        /// so only the output of the last step is kept (backprop reports an error in this mode)
+        /// Switching to inference frees the outputs and input gradients that training kept
+        void setTraining(bool _training);
+
+        /// Gradient checkpointing: in training, only the output of every _interval-th step is kept,
+        /// the others are recomputed from the previous one during backprop (0 keeps every output)
+        void setCheckpointing(size_t _interval);
+
+        /// The input gradients of consecutive steps share two buffers during backprop (off by default),
+        /// once it returns getLayer(i)->getInputGrad() is then only valid for the first step; the others hold unrelated values
+        void setGradientSharing(bool _share);
+
+        /// Post-training quantization: records the largest absolute input of each Linear and Convolutional layer
+        /// over the inputs of a calibration DataSet, then switches these layers to int8 inference
+        /// Linear layers run in int8 only while the network is not training (see setTraining)
+        void quantize(const std::vector<Example>& _calibration);
+
         const Tensor& feedForward(const Tensor& _input);
+
+        /// Every step keeps its input gradient, unless gradient sharing is enabled
         void backprop(const Tensor& _input, const Tensor& _outputGrad);
         #endif // USE_OPENCL
 
@@ -45,14 +76,49 @@ class Network
         void setParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad);
         void getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad) const;
 
-        bool saveToFile(const std::string& _file) const;
-        bool loadFromFile(const std::string& _file);
+        // Snapshots of every parameter in one contiguous buffer, in the order of getParams
+        void getParams(Tensor& _params) const;
+        bool setParams(const Tensor& _params);
+
+        enum class FileFormat
+        {
+            TEXT,   // Human readable, values printed one by one
+            BINARY  // Versioned header, description of the layers, then little endian parameters aligned on 64 bytes
+        };
+
+        bool saveToFile(const std::string& _file, FileFormat _format = FileFormat::TEXT) const;
+        bool loadFromFile(const std::string& _file); // Either format, detected from the header
+
+        /// Rewrites a text model file in the binary format
+        static bool convertToBinary(const std::string& _textFile, const std::string& _binaryFile);
 
     private:
+        void updateSteps();
+
+        Layer* loadLayer(const std::string& _layerType, std::ifstream& _file) const;
+
+        void saveText(std::ofstream& _file) const;
+        void saveBinary(std::ofstream& _file) const;
+        void loadText(std::ifstream& _file);
+        bool loadBinary(const std::string& _fileName, std::ifstream& _file);
+
         std::vector<Layer*> layers;
+        std::vector<Layer*> steps; // Layers that are run: activations fused in the previous layer are skipped
+        bool fusion;
 
         #ifdef USE_OPENCL
         cl::Context context;
+        #else
+        bool keepsOutput(size_t _step) const;
+
+        bool training;
+        bool keepAllOutputs; // Calibration runs the layers in inference mode but needs every intermediate output
+        size_t checkpointInterval;
+        bool shareGradients;
+
+        Tensor activations[2]; // Ping-pong buffers for the outputs that are not kept
+        Tensor gradients[2]; // Ping-pong buffers for the input gradients of all steps but the first one
+        std::vector<Tensor> recomputed; // Outputs between two checkpoints, during backprop
         #endif // USE_OPENCL
 };
 
@@ -14,10 +14,10 @@ class Adam: public Optimizer
         void openCL(cl::Context& _context);
 
     protected:
-        void updateParams(cl::CommandQueue& _commandQueue);
+        void updateParams(cl::CommandQueue& _commandQueue, Tensor::value_type _gradScale);
         #else
     protected:
-        void updateParams();
+        void updateParams(Tensor::value_type _gradScale);
         #endif // USE_OPENCL
 
         Tensor::value_type learningRate, learningRateDecay, rho1, rho2, delta;
@@ -2,6 +2,8 @@
 
 #include "Utility/Tensor.h"
 
+#include <functional>
+
 namespace rna
 {
 
@@ -12,10 +14,13 @@ class Optimizer
         virtual ~Optimizer() {}
 
         #ifdef USE_OPENCL
-        virtual void openCL(cl::Context& _context);
+        virtual void openCL(cl::Context& _context) = 0;
 
+        /// The learning rates apply to the mean gradient of the minibatch, as on CPU: the summed gradients are scaled by 1/_batchSize
+        /// Earlier versions applied them to the sum on OpenCL, their learning rates must be multiplied by the batch size to take the same steps
         void updateParams(cl::CommandQueue& _commandQueue, size_t _batchSize);
         #else
+        /// The learning rates apply to the mean gradient of the minibatch: the summed gradients are scaled by 1/_batchSize
         void updateParams(size_t _batchSize);
         #endif // USE_OPENCL
 
@@ -24,11 +29,23 @@ class Optimizer
         std::vector<Tensor*>* paramsGrad;
 
         #ifdef USE_OPENCL
-        cl::Kernel averageKernel, updateKernel;
+        /// Number of tensors handled by a single launch of the update kernels
+        static const size_t TENSORS_PER_LAUNCH = 8;
+
+        cl::Kernel updateKernel;
 
-        virtual void updateParams(cl::CommandQueue& _commandQueue) = 0;
+        /// Single pass over every parameter: the gradients are scaled by _gradScale, used then reset to zero
+        virtual void updateParams(cl::CommandQueue& _commandQueue, Tensor::value_type _gradScale) = 0;
+
+        /// Sets the tensor slots of updateKernel from argument _firstSlot onwards, TENSORS_PER_LAUNCH at a time,
+        /// and launches it once per group. Each slot is (param, grad, _states..., end of its range)
+        void enqueueUpdate(cl::CommandQueue& _commandQueue, unsigned _firstSlot, const std::vector<std::vector<Tensor>*>& _states);
         #else
-        virtual void updateParams() = 0;
+        /// Single pass over every parameter: the gradients are scaled by _gradScale, used then reset to zero
+        virtual void updateParams(Tensor::value_type _gradScale) = 0;
+
+        /// Splits all the parameters into chunks and calls _step(i, begin, end) on the thread pool
+        void forEachChunk(const std::function<void(size_t, size_t, size_t)>& _step) const;
         #endif // USE_OPENCL
 
         int iteration; // TODO: auto increment ?
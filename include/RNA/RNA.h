@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Network.h"
+#include "ThreadPool.h"
 
 #include "Losses/MSE.h"
 #include "Losses/NLL.h"
+#include "Losses/CrossEntropy.h"
 #include "Losses/Huber.h"
 
 #include "Layers/Linear.h"
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rna
+{
+
+class ThreadPool
+{
+    public:
+        ThreadPool(size_t _threads = 0); // 0: one thread per core
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void resize(size_t _threads);
+        size_t size() const;
+
+        /// Calls _task(i) for each i in [0, _tasks) and waits for all of them
+        /// The calling thread takes part in the work; calls made from inside a task run serially
+        void run(size_t _tasks, const std::function<void(size_t)>& _task);
+
+        static ThreadPool& global();
+
+    private:
+        void start(size_t _threads);
+        void stop();
+
+        void work(size_t _generation);
+        void execute();
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex, runMutex;
+        std::condition_variable wakeUp, finished;
+
+        const std::function<void(size_t)>* task;
+        size_t taskCount;
+        std::atomic<size_t> nextTask;
+
+        size_t activeWorkers;
+        size_t generation;
+        bool quit;
+};
+
+}
@@ -52,6 +52,8 @@ class Supervised
 
             #ifdef USE_OPENCL
             loss->openCL(network->getContext());
+            #else
+            lossFactory = [args...]() -> Loss* { return new L(args...); };
             #endif // USE_OPENCL
         }
 
@@ -72,6 +74,29 @@ class Supervised
         Loss* loss;
         Optimizer* optimizer;
 
+        #ifndef USE_OPENCL
+        // Network run by one thread on its share of the minibatch
+        struct Replica
+        {
+            Network* network;
+            Loss* loss;
+
+            std::vector<Tensor*> params, paramsGrad;
+            Example shard;
+        };
+
+        /// Returns the number of workers available
+        /// Replicas are cloned at the start of each call of train and released at its end, so they follow every change made to the network in between
+        size_t createReplicas(size_t _workers);
+        void releaseReplicas();
+
+        /// Copies the parameters of the network into every replica, the work being split across the thread pool
+        void syncReplicas();
+
+        std::function<Loss*()> lossFactory; // Each worker needs its own loss
+        std::vector<Replica> replicas; // The first one is the network itself
+        #endif // USE_OPENCL
+
         std::vector<Tensor*> params, paramsGrad;
 };
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#ifdef USE_OPENCL
+#include "Utility/clWrapper.h"
+
+#include <string>
+
+namespace rna
+{
+
+/// Returns the program of a kernel file embedded in the library at build time, e.g. "linear.cl", through Context::getProgram
+/// The embedded source is first copied to <directory>/<name>-<hash of the source>.cl, then checked again at each hit,
+/// so a newer library never builds a stale kernel and nothing is read from the working directory
+/// The directory is RNA_KERNEL_CACHE, else $XDG_CACHE_HOME/RNA or ~/.cache/RNA (%LOCALAPPDATA%/RNA on Windows),
+/// used only when nobody but the current user can write to it, else a new private directory in the temporary one
+/// When the kernel is not embedded or its source cannot be written, an error is added and the context is given an empty path,
+/// which it fails to build
+cl::Program& getProgram(cl::Context& _context, const std::string& _file);
+
+}
+#endif // USE_OPENCL
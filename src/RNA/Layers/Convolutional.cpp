@@ -1,7 +1,15 @@
 #include "RNA/Layers/Convolutional.h"
+#include "RNA/Maths/fft.h"
+#include "RNA/Maths/gemm.h"
+#include "RNA/Maths/im2col.h"
+#include "RNA/Maths/winograd.h"
+#include "RNA/ThreadPool.h"
+#include "RNA/kernels.h"
 #include "Utility/Error.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 
 #ifdef TENSOR_SAFE
 #include <iostream>
@@ -10,19 +18,26 @@
 namespace rna
 {
 
-Convolutional::Convolutional(coords_t inputDimensions, coords_t kernelDimensions, size_t _outputChannels):
+#ifndef USE_OPENCL
+const size_t Convolutional::DIRECT_CONVOLUTION_MAX_MACS = 4096;
+#endif // USE_OPENCL
+
+Convolutional::Convolutional(coords_t inputDimensions, coords_t kernelDimensions, size_t _outputChannels, bool _randomize):
     Layer("Convolutional"),
     weights{_outputChannels, inputDimensions[0], kernelDimensions[0], kernelDimensions[1]},
-    bias{_outputChannels, inputDimensions[1]-kernelDimensions[0]+1, inputDimensions[2]-kernelDimensions[1]+1}
+    bias{_outputChannels, inputDimensions[1]-kernelDimensions[0]+1, inputDimensions[2]-kernelDimensions[1]+1},
+    algorithm(Algorithm::DEFAULT), transformedWeightsValid(false)
 {
-    randomize();
+    if (_randomize)
+        randomize();
 
     weightsGrad.resizeAs(weights);
     biasGrad.resizeAs(bias);
 }
 
 Convolutional::Convolutional(std::ifstream& _file):
-    Layer("Convolutional")
+    Layer("Convolutional"),
+    algorithm(Algorithm::DEFAULT), transformedWeightsValid(false)
 {
     coords_t weightsDimensions(4), biasDimensions(3);
     _file >> weightsDimensions[0] >> weightsDimensions[1] >> weightsDimensions[2] >> weightsDimensions[3];
@@ -53,12 +68,40 @@ void Convolutional::randomize()
 {
     weights.randomize(Layer::WEIGHT_INIT_MIN, Layer::WEIGHT_INIT_MAX);
     bias.randomize(Layer::BIAS_INIT_MIN, Layer::BIAS_INIT_MAX);
+
+    transformedWeightsValid = false;
+}
+
+void Convolutional::setAlgorithm(Algorithm _algorithm)
+{
+    if (_algorithm == Algorithm::WINOGRAD && (weights.size(2) != 3 || weights.size(3) != 3))
+    {
+        Error::add(ErrorType::USER_ERROR, "Convolutional::setAlgorithm => Winograd requires 3x3 kernels");
+        return;
+    }
+
+    #ifdef USE_OPENCL
+    if (_algorithm == Algorithm::FFT)
+    {
+        Error::add(ErrorType::USER_ERROR, "Convolutional::setAlgorithm => FFT convolutions are only implemented on CPU");
+        return;
+    }
+    #endif // USE_OPENCL
+
+    if (_algorithm == Algorithm::INT8)
+    {
+        Error::add(ErrorType::USER_ERROR, "Convolutional::setAlgorithm => int8 needs a calibrated input range, see Network::quantize");
+        return;
+    }
+
+    algorithm = _algorithm;
+    transformedWeightsValid = false;
 }
 
 #ifdef USE_OPENCL
 void Convolutional::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/convolutional.cl");
+    auto& p = getProgram(_context, "convolutional.cl");
 
     forwardKernel.create(p, "feedForwardConvolutional");
     backwardKernel.create(p, "backpropConvolutional");
@@ -66,6 +109,9 @@ void Convolutional::openCL(cl::Context& _context)
     weightsGradKernel.create(p, "weightsGradConvolutional");
     biasGradKernel.create(p, "biasGradConvolutional");
 
+    winogradWeightsKernel.create(p, "winogradWeightsConvolutional");
+    winogradForwardKernel.create(p, "feedForwardWinograd");
+
 
     weights.openCL(_context);
     bias.openCL(_context);
@@ -79,18 +125,35 @@ void Convolutional::openCL(cl::Context& _context)
     forwardKernel.setArg(4, weights.size(1));
     forwardKernel.setArg(5, weights.size(2));
     forwardKernel.setArg(6, weights.size(3));
+    forwardKernel.setArg(7, weights.size(0));
 
     backwardKernel.setArg(2, weights);
     backwardKernel.setArg(3, weights.size(0));
     backwardKernel.setArg(4, weights.size(2));
     backwardKernel.setArg(5, weights.size(3));
+    backwardKernel.setArg(6, weights.size(1));
 
     weightsGradKernel.setArg(0, weightsGrad);
     weightsGradKernel.setArg(4, bias.size(0));
     weightsGradKernel.setArg(5, bias.size(1));
     weightsGradKernel.setArg(6, bias.size(2));
+    weightsGradKernel.setArg(7, weights.size(1));
 
     biasGradKernel.setArg(0, biasGrad);
+
+    transformedWeights.resize({16, weights.size(0), weights.size(1)});
+    transformedWeights.openCL(_context);
+    transformedWeightsValid = false;
+
+    winogradWeightsKernel.setArg(0, transformedWeights);
+    winogradWeightsKernel.setArg(1, weights);
+
+    winogradForwardKernel.setArg(2, transformedWeights);
+    winogradForwardKernel.setArg(3, bias);
+    winogradForwardKernel.setArg(4, weights.size(1));
+    winogradForwardKernel.setArg(5, bias.size(1));
+    winogradForwardKernel.setArg(6, bias.size(2));
+    winogradForwardKernel.setArg(7, weights.size(0));
 }
 
 void Convolutional::releaseCL()
@@ -99,6 +162,9 @@ void Convolutional::releaseCL()
 
     weightsGradKernel.release();
     biasGradKernel.release();
+
+    winogradWeightsKernel.release();
+    winogradForwardKernel.release();
 }
 
 void Convolutional::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch)
@@ -106,14 +172,27 @@ void Convolutional::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _
     output.resize({_inputBatch.size(0), weights.size(0), _inputBatch.size(2)-weights.size(2)+1, _inputBatch.size(3)-weights.size(3)+1});
     output.openCL(_commandQueue.getContext());
 
+    if (algorithm == Algorithm::WINOGRAD)
+    {
+        if (!transformedWeightsValid)
+        {
+            _commandQueue.enqueueKernel(winogradWeightsKernel, {weights.size(0), weights.size(1)});
+            transformedWeightsValid = true;
+        }
+
+        winogradForwardKernel.setArg(0, output);
+        winogradForwardKernel.setArg(1,_inputBatch);
+
+        _commandQueue.enqueueKernel(winogradForwardKernel, {output.size(0)*bias.size(0), (bias.size(1)+1) / 2, (bias.size(2)+1) / 2});
+
+        return;
+    }
+
+    // One launch for the whole batch: samples and channels share the first dimension
     forwardKernel.setArg(0, output);
     forwardKernel.setArg(1,_inputBatch);
 
-    for (int i(0) ; i < (int)_inputBatch.size(0) ; i++)
-    {
-        forwardKernel.setArg(7, i);
-        _commandQueue.enqueueKernel(forwardKernel, bias.size());
-    }
+    _commandQueue.enqueueKernel(forwardKernel, {output.size(0)*bias.size(0), bias.size(1), bias.size(2)});
 }
 
 void Convolutional::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -121,6 +200,9 @@ void Convolutional::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inp
     // Start with paramsGrad to enqueue barrier on inputGrad
     updateParamsGrad(_commandQueue, _inputBatch, _outputGradBatch);
     updateInputGrad(_commandQueue, _inputBatch, _outputGradBatch);
+
+    // Weights are about to be updated by the optimizer
+    transformedWeightsValid = false;
 }
 
 void Convolutional::updateInputGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -131,15 +213,7 @@ void Convolutional::updateInputGrad(cl::CommandQueue& _commandQueue, const Tenso
     backwardKernel.setArg(0, inputGrad);
     backwardKernel.setArg(1,_outputGradBatch);
 
-//    std::vector<cl_event> events(_inputBatch.size(0), nullptr);
-
-    for (int i(0) ; i < (int)_inputBatch.size(0) ; i++)
-    {
-        backwardKernel.setArg(6, i);
-        _commandQueue.enqueueKernel(backwardKernel, {inputGrad.size(1), inputGrad.size(2), inputGrad.size(3)} /*, &events[i]*/ );
-    }
-
-//    _commandQueue.enqueueBarrier(events);
+    _commandQueue.enqueueKernel(backwardKernel, {inputGrad.size(0)*inputGrad.size(1), inputGrad.size(2), inputGrad.size(3)});
 }
 
 void Convolutional::updateParamsGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -149,11 +223,7 @@ void Convolutional::updateParamsGrad(cl::CommandQueue& _commandQueue, const Tens
     weightsGradKernel.setArg(2,_inputBatch);
     weightsGradKernel.setArg(3,_outputGradBatch.size(0));
 
-    for (int i(0) ; i < (int)weights.size(0) ; i++)
-    {
-        weightsGradKernel.setArg(7, i);
-        _commandQueue.enqueueKernel(weightsGradKernel, {weightsGrad.size(1), weightsGrad.size(2), weightsGrad.size(3)});
-    }
+    _commandQueue.enqueueKernel(weightsGradKernel, {weightsGrad.size(0)*weightsGrad.size(1), weightsGrad.size(2), weightsGrad.size(3)});
 
     // biasGrad
     biasGradKernel.setArg(1,_outputGradBatch);
@@ -163,18 +233,439 @@ void Convolutional::updateParamsGrad(cl::CommandQueue& _commandQueue, const Tens
 }
 
 #else
+void Convolutional::quantize(Tensor::value_type _inputRange)
+{
+    algorithm = Algorithm::INT8;
+    inputScale = (_inputRange > 0.0f)? _inputRange / 127.0f: 1.0f;
+
+    transformedWeightsValid = false;
+}
+
+Layer* Convolutional::clone() const
+{
+    return new Convolutional(*this);
+}
+
 void Convolutional::feedForward(const Tensor& _input)
 {
-    convolve(output, weights, _input);
-    output += bias;
+    bool batched = _input.nDimensions() == 4;
+
+    if (algorithm == Algorithm::DEFAULT && !batched && useDirectConvolution())
+    {
+        convolve(output, weights, _input);
+        output += bias;
+
+        return;
+    }
+
+    size_t batchSize = batched? _input.size(0): 1;
+
+    if (batched)
+        output.resize({batchSize, bias.size(0), bias.size(1), bias.size(2)});
+    else
+        output.resizeAs(bias);
+
+    switch (algorithm)
+    {
+        case Algorithm::WINOGRAD:
+            winogradForward(_input, batchSize);
+            break;
+
+        case Algorithm::FFT:
+            fftForward(_input, batchSize);
+            break;
+
+        case Algorithm::INT8:
+            int8Forward(_input, batchSize);
+            break;
+
+        default:
+            gemmForward(_input, batchSize);
+    }
 }
 
 void Convolutional::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
-    convGradInput(inputGrad, weights, _outputGrad);
+    bool batched = _input.nDimensions() == 4;
+
+    if (algorithm == Algorithm::DEFAULT && !batched && useDirectConvolution())
+    {
+        convGradInput(inputGrad, weights, _outputGrad);
+
+        convGradWeight(weightsGrad, _outputGrad, _input);
+        biasGrad += _outputGrad;
+
+        return;
+    }
+
+    size_t batchSize = batched? _input.size(0): 1;
+
+    inputGrad.resizeAs(_input);
+
+    switch (algorithm)
+    {
+        case Algorithm::WINOGRAD:
+            gemmWeightsGrad(_input, _outputGrad, batchSize);
+            winogradInputGrad(_outputGrad, batchSize);
+            break;
+
+        case Algorithm::FFT:
+            fftBackprop(_input, _outputGrad, batchSize);
+            break;
+
+        default:
+            gemmWeightsGrad(_input, _outputGrad, batchSize);
+            gemmInputGrad(_outputGrad, batchSize);
+    }
+
+    addRows(biasGrad.data(), _outputGrad.data(), batchSize, bias.nElements());
+
+    // Weights are about to be updated by the optimizer
+    transformedWeightsValid = false;
+}
+
+bool Convolutional::useDirectConvolution() const
+{
+    // Lowering costs a copy of every patch: only worth it once there is enough arithmetic to amortize it
+    return weights.nElements() * bias.size(1) * bias.size(2) < DIRECT_CONVOLUTION_MAX_MACS;
+}
+
+void Convolutional::updateTransformedWeights()
+{
+    if (transformedWeightsValid)
+        return;
+
+    size_t outputChannels = weights.size(0), inputChannels = weights.size(1);
+    size_t kernelSize = weights.size(2) * weights.size(3);
+
+    if (algorithm == Algorithm::WINOGRAD)
+    {
+        transformedWeights.resize({16, outputChannels, inputChannels});
+        winogradWeightsT.resize({16, inputChannels, outputChannels});
+
+        for (size_t o(0) ; o < outputChannels ; o++)
+        {
+            for (size_t c(0) ; c < inputChannels ; c++)
+            {
+                const Tensor::value_type* kernel = weights.data() + (o*inputChannels + c) * kernelSize;
+
+                // The layer computes a convolution while Winograd computes a correlation
+                Tensor::value_type flipped[9];
+                for (size_t i(0) ; i < 9 ; i++)
+                    flipped[i] = kernel[8-i];
+
+                winogradKernel(transformedWeights.data() + o*inputChannels + c, outputChannels*inputChannels, flipped);
+                winogradKernel(winogradWeightsT.data() + c*outputChannels + o, outputChannels*inputChannels, kernel);
+            }
+        }
+    }
+    else if (algorithm == Algorithm::FFT)
+    {
+        size_t rows = nextPowerOfTwo(bias.size(1) + weights.size(2) - 1);
+        size_t columns = nextPowerOfTwo(bias.size(2) + weights.size(3) - 1);
+
+        transformedWeights.resize({outputChannels, inputChannels, rows, columns, 2});
+        Complex* spectra = reinterpret_cast<Complex*>(transformedWeights.data());
+
+        for (size_t k(0) ; k < outputChannels*inputChannels ; k++)
+            realToSpectrum(spectra + k*rows*columns, weights.data() + k*kernelSize, weights.size(2), weights.size(3), rows, columns);
+    }
+    else if (algorithm == Algorithm::INT8)
+        int8Weights.quantize(weights.data(), outputChannels, inputChannels*kernelSize);
+
+    transformedWeightsValid = true;
+}
+
+
+/// im2col + gemm
+void Convolutional::gemmForward(const Tensor& _input, size_t _batchSize)
+{
+    size_t inputWidth = bias.size(1) + weights.size(2) - 1, inputHeight = bias.size(2) + weights.size(3) - 1;
+
+    size_t patchSize = weights.size(1) * weights.size(2) * weights.size(3);
+    size_t planeSize = bias.size(1) * bias.size(2);
+
+    size_t inputStride = weights.size(1) * inputWidth * inputHeight;
+    size_t outputStride = bias.nElements();
+
+    columns.resize({patchSize, planeSize});
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        Tensor::value_type* sampleOutput = output.data() + n*outputStride;
+
+        im2col(columns.data(), _input.data() + n*inputStride, weights.size(1), inputWidth, inputHeight, weights.size(2), weights.size(3));
+        std::copy(bias.data(), bias.data() + outputStride, sampleOutput);
+
+        gemm(false, false, weights.size(0), planeSize, patchSize,
+             1.0f, weights.data(), patchSize, columns.data(), planeSize,
+             1.0f, sampleOutput, planeSize);
+    }
+}
+
+void Convolutional::gemmWeightsGrad(const Tensor& _input, const Tensor& _outputGrad, size_t _batchSize)
+{
+    size_t inputWidth = bias.size(1) + weights.size(2) - 1, inputHeight = bias.size(2) + weights.size(3) - 1;
+
+    size_t patchSize = weights.size(1) * weights.size(2) * weights.size(3);
+    size_t planeSize = bias.size(1) * bias.size(2);
+
+    size_t inputStride = weights.size(1) * inputWidth * inputHeight;
+    size_t outputStride = bias.nElements();
+
+    columns.resize({patchSize, planeSize});
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        im2col(columns.data(), _input.data() + n*inputStride, weights.size(1), inputWidth, inputHeight, weights.size(2), weights.size(3));
+
+        gemm(false, true, weights.size(0), patchSize, planeSize,
+             1.0f, _outputGrad.data() + n*outputStride, planeSize, columns.data(), planeSize,
+             1.0f, weightsGrad.data(), patchSize);
+    }
+}
+
+void Convolutional::gemmInputGrad(const Tensor& _outputGrad, size_t _batchSize)
+{
+    size_t inputWidth = bias.size(1) + weights.size(2) - 1, inputHeight = bias.size(2) + weights.size(3) - 1;
+
+    size_t patchSize = weights.size(1) * weights.size(2) * weights.size(3);
+    size_t planeSize = bias.size(1) * bias.size(2);
+
+    size_t inputStride = weights.size(1) * inputWidth * inputHeight;
+    size_t outputStride = bias.nElements();
+
+    columns.resize({patchSize, planeSize});
+    inputGrad.fill(0.0f);
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        // Gradient of the patches, scattered back to the image
+        gemm(true, false, patchSize, planeSize, weights.size(0),
+             1.0f, weights.data(), patchSize, _outputGrad.data() + n*outputStride, planeSize,
+             0.0f, columns.data(), planeSize);
+
+        col2im(inputGrad.data() + n*inputStride, columns.data(), weights.size(1), inputWidth, inputHeight, weights.size(2), weights.size(3));
+    }
+}
+
+
+/// Winograd
+void Convolutional::winogradForward(const Tensor& _input, size_t _batchSize)
+{
+    size_t inputWidth = bias.size(1) + 2, inputHeight = bias.size(2) + 2;
+    size_t outputStride = bias.nElements();
+
+    updateTransformedWeights();
+
+    winogradCorrelate(output.data(), _input.data(), transformedWeights.data(),
+                      _batchSize, weights.size(1), weights.size(0),
+                      inputWidth, inputHeight, 0, workspace);
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+        addRows(output.data() + n*outputStride, bias.data(), 1, outputStride);
+}
+
+void Convolutional::winogradInputGrad(const Tensor& _outputGrad, size_t _batchSize)
+{
+    // Full correlation of the output gradient with the unflipped kernels
+    winogradCorrelate(inputGrad.data(), _outputGrad.data(), winogradWeightsT.data(),
+                      _batchSize, weights.size(0), weights.size(1),
+                      bias.size(1), bias.size(2), 2, workspace);
+}
+
+
+/// FFT
+namespace
+{
+
+// Below this number of spectrum values per pass, the calling thread processes the channels alone
+const size_t PARALLEL_MIN_SPECTRUM_VALUES = 1 << 15;
+
+void forEachChannel(size_t _channels, size_t _spectrumSize, const std::function<void(size_t)>& _task)
+{
+    if (_channels * _spectrumSize < PARALLEL_MIN_SPECTRUM_VALUES)
+    {
+        for (size_t k(0) ; k < _channels ; k++)
+            _task(k);
+    }
+    else
+        ThreadPool::global().run(_channels, _task);
+}
 
-    convGradWeight(weightsGrad, _outputGrad, _input);
-    biasGrad += _outputGrad;
+}
+
+void Convolutional::fftForward(const Tensor& _input, size_t _batchSize)
+{
+    size_t outputChannels = weights.size(0), inputChannels = weights.size(1);
+    size_t kernelWidth = weights.size(2), kernelHeight = weights.size(3);
+
+    size_t outputWidth = bias.size(1), outputHeight = bias.size(2);
+    size_t inputWidth = outputWidth + kernelWidth - 1, inputHeight = outputHeight + kernelHeight - 1;
+
+    // Circular convolution of this size does not wrap around on the valid part of the output
+    size_t rows = nextPowerOfTwo(inputWidth), columns = nextPowerOfTwo(inputHeight);
+    size_t spectrumSize = rows * columns;
+
+    updateTransformedWeights();
+    const Complex* weightsSpectra = reinterpret_cast<const Complex*>(transformedWeights.data());
+
+    workspace.resize(2 * spectrumSize * (inputChannels + outputChannels));
+    Complex* inputSpectra = reinterpret_cast<Complex*>(workspace.data());
+    Complex* outputSpectra = inputSpectra + inputChannels*spectrumSize;
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        forEachChannel(inputChannels, spectrumSize, [&](size_t c)
+        {
+            realToSpectrum(inputSpectra + c*spectrumSize, _input.data() + (n*inputChannels + c) * inputWidth*inputHeight, inputWidth, inputHeight, rows, columns);
+        });
+
+        forEachChannel(outputChannels, spectrumSize, [&](size_t o)
+        {
+            Complex* outputSpectrum = outputSpectra + o*spectrumSize;
+
+            std::fill(outputSpectrum, outputSpectrum + spectrumSize, Complex(0.0f, 0.0f));
+
+            for (size_t c(0) ; c < inputChannels ; c++)
+                multiplyAccumulate(outputSpectrum, weightsSpectra + (o*inputChannels + c) * spectrumSize, inputSpectra + c*spectrumSize, spectrumSize);
+
+            fft2d(outputSpectrum, rows, columns, true);
+
+            // Keep the valid part
+            Tensor::value_type* sampleOutput = output.data() + (n*outputChannels + o) * outputWidth*outputHeight;
+            const Tensor::value_type* channelBias = bias.data() + o * outputWidth*outputHeight;
+
+            for (size_t x(0) ; x < outputWidth ; x++)
+                for (size_t y(0) ; y < outputHeight ; y++)
+                    sampleOutput[x*outputHeight + y] = outputSpectrum[(x+kernelWidth-1)*columns + y+kernelHeight-1].real() + channelBias[x*outputHeight + y];
+        });
+    }
+}
+
+void Convolutional::fftBackprop(const Tensor& _input, const Tensor& _outputGrad, size_t _batchSize)
+{
+    size_t outputChannels = weights.size(0), inputChannels = weights.size(1);
+    size_t kernelWidth = weights.size(2), kernelHeight = weights.size(3);
+
+    size_t outputWidth = bias.size(1), outputHeight = bias.size(2);
+    size_t inputWidth = outputWidth + kernelWidth - 1, inputHeight = outputHeight + kernelHeight - 1;
+
+    size_t rows = nextPowerOfTwo(inputWidth), columns = nextPowerOfTwo(inputHeight);
+    size_t spectrumSize = rows * columns;
+
+    updateTransformedWeights();
+    const Complex* weightsSpectra = reinterpret_cast<const Complex*>(transformedWeights.data());
+
+    workspace.resize(2 * spectrumSize * (2*inputChannels + outputChannels + inputChannels*outputChannels));
+    Complex* inputSpectra = reinterpret_cast<Complex*>(workspace.data());
+    Complex* gradSpectra = inputSpectra + inputChannels*spectrumSize;
+    Complex* weightsGradSpectra = gradSpectra + outputChannels*spectrumSize;
+    Complex* inputGradSpectra = weightsGradSpectra + outputChannels*inputChannels*spectrumSize;
+
+    // Gradients are linear: weightsGrad is accumulated over the batch in the Fourier domain
+    std::fill(weightsGradSpectra, weightsGradSpectra + outputChannels*inputChannels*spectrumSize, Complex(0.0f, 0.0f));
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        forEachChannel(inputChannels + outputChannels, spectrumSize, [&](size_t k)
+        {
+            if (k < inputChannels)
+                realToSpectrum(inputSpectra + k*spectrumSize, _input.data() + (n*inputChannels + k) * inputWidth*inputHeight, inputWidth, inputHeight, rows, columns);
+            else
+            {
+                size_t o = k - inputChannels;
+                realToSpectrum(gradSpectra + o*spectrumSize, _outputGrad.data() + (n*outputChannels + o) * outputWidth*outputHeight, outputWidth, outputHeight, rows, columns);
+            }
+        });
+
+        // inputGrad: correlation of the output gradient with the kernels
+        forEachChannel(inputChannels, spectrumSize, [&](size_t c)
+        {
+            Complex* spectrum = inputGradSpectra + c*spectrumSize;
+            std::fill(spectrum, spectrum + spectrumSize, Complex(0.0f, 0.0f));
+
+            for (size_t o(0) ; o < outputChannels ; o++)
+                multiplyAccumulate(spectrum, weightsSpectra + (o*inputChannels + c) * spectrumSize, gradSpectra + o*spectrumSize, spectrumSize, true);
+
+            fft2d(spectrum, rows, columns, true);
+
+            // Lag i-kernelWidth+1 (circular)
+            Tensor::value_type* sampleInputGrad = inputGrad.data() + (n*inputChannels + c) * inputWidth*inputHeight;
+
+            for (size_t i(0) ; i < inputWidth ; i++)
+            {
+                size_t u = (i + rows - kernelWidth + 1) % rows;
+
+                for (size_t j(0) ; j < inputHeight ; j++)
+                    sampleInputGrad[i*inputHeight + j] = spectrum[u*columns + (j + columns - kernelHeight + 1) % columns].real();
+            }
+        });
+
+        // weightsGrad: correlation of the input with the output gradient
+        forEachChannel(outputChannels, spectrumSize, [&](size_t o)
+        {
+            for (size_t c(0) ; c < inputChannels ; c++)
+                multiplyAccumulate(weightsGradSpectra + (o*inputChannels + c) * spectrumSize, gradSpectra + o*spectrumSize, inputSpectra + c*spectrumSize, spectrumSize, true);
+        });
+    }
+
+    forEachChannel(outputChannels*inputChannels, spectrumSize, [&](size_t k)
+    {
+        Complex* kernelSpectrum = weightsGradSpectra + k*spectrumSize;
+        fft2d(kernelSpectrum, rows, columns, true);
+
+        // Lag kernelWidth-1-i
+        Tensor::value_type* kernelGrad = weightsGrad.data() + k * kernelWidth*kernelHeight;
+
+        for (size_t i(0) ; i < kernelWidth ; i++)
+            for (size_t j(0) ; j < kernelHeight ; j++)
+                kernelGrad[i*kernelHeight + j] += kernelSpectrum[(kernelWidth-1-i)*columns + kernelHeight-1-j].real();
+    });
+}
+
+
+/// im2col + int8 gemm
+void Convolutional::int8Forward(const Tensor& _input, size_t _batchSize)
+{
+    size_t inputWidth = bias.size(1) + weights.size(2) - 1, inputHeight = bias.size(2) + weights.size(3) - 1;
+
+    size_t patchSize = weights.size(1) * weights.size(2) * weights.size(3);
+    size_t planeSize = bias.size(1) * bias.size(2);
+
+    size_t inputStride = weights.size(1) * inputWidth * inputHeight;
+    size_t outputStride = bias.nElements();
+
+    updateTransformedWeights();
+
+    // Patches are quantized as rows: the product gives the transposed output (planeSize x outputChannels)
+    size_t outputChannels = weights.size(0);
+
+    columns.resize({patchSize, planeSize});
+    int8Columns.resize(planeSize * int8Weights.stride);
+    workspace.resize(planeSize * outputChannels);
+
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        Tensor::value_type* sampleOutput = output.data() + n*outputStride;
+
+        // Blocks are transposed into the output and biased while they are in cache
+        auto epilogue = [&](Tensor::value_type* _block, size_t _ld, size_t _row, size_t _column, size_t _rows, size_t _columns)
+        {
+            for (size_t j(0) ; j < _columns ; j++)
+            {
+                size_t offset = (_column+j)*planeSize + _row;
+
+                for (size_t i(0) ; i < _rows ; i++)
+                    sampleOutput[offset + i] = _block[i*_ld + j] + bias[offset + i];
+            }
+        };
+
+        im2col(columns.data(), _input.data() + n*inputStride, weights.size(1), inputWidth, inputHeight, weights.size(2), weights.size(3));
+        quantizeColumns(int8Columns.data(), int8Weights.stride, columns.data(), patchSize, planeSize, inputScale);
+
+        gemmInt8(planeSize, int8Columns.data(), inputScale, int8Weights, workspace.data(), outputChannels, epilogue);
+    }
 }
 #endif // USE_OPENCL
 
@@ -195,6 +686,8 @@ void Convolutional::setParams(std::vector<Tensor*>& _params, std::vector<Tensor*
     // weights
         weights = *_params.back();
         _params.pop_back();
+
+    transformedWeightsValid = false;
 }
 
 void Convolutional::getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad)
@@ -207,6 +700,11 @@ void Convolutional::getParams(std::vector<Tensor*>& _params, std::vector<Tensor*
 }
 
 
+void Convolutional::parametersChanged()
+{
+    transformedWeightsValid = false;
+}
+
 void Convolutional::saveToFile(std::ofstream& _file) const
 {
     Layer::saveToFile(_file);
@@ -1,26 +1,65 @@
 #include "RNA/Layers/Dropout.h"
+#include "RNA/Maths/philox.h"
+#include "RNA/kernels.h"
 #include "Utility/Random.h"
 
 #include <fstream>
+#include <limits>
 
 namespace rna
 {
 
 Dropout::Dropout(Tensor::value_type _rate):
     Layer("Dropout"),
-    rate(_rate)
-{}
+    rate(_rate), training(true)
+{
+    seed();
+}
 
 Dropout::Dropout(std::ifstream& _file):
-    Layer("Dropout")
+    Layer("Dropout"),
+    training(true)
 {
     _file >> rate;
+
+    seed();
+}
+
+void Dropout::setTraining(bool _training)
+{
+    training = _training;
+}
+
+void Dropout::seed()
+{
+    key[0] = Random::next<int>(0, std::numeric_limits<int>::max());
+    key[1] = Random::next<int>(0, std::numeric_limits<int>::max());
+    run = 0;
+}
+
+void Dropout::setSeed(uint64_t _seed)
+{
+    key[0] = uint32_t(_seed);
+    key[1] = uint32_t(_seed >> 32);
+    run = 0;
+}
+
+uint32_t Dropout::threshold() const
+{
+    double threshold = rate * 4294967296.0;
+
+    return (threshold < 4294967295.0)? uint32_t(threshold): std::numeric_limits<uint32_t>::max();
+}
+
+Tensor::value_type Dropout::scale() const
+{
+    return (rate < 1.0f)? 1.0f / (1.0f - rate): 0.0f;
 }
 
 #ifdef USE_OPENCL
 void Dropout::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/dropout.cl");
+    auto& p = getProgram(_context, "dropout.cl");
 
     forwardKernel.create(p, "feedForwardDropout");
     backwardKernel.create(p, "backpropDropout");
@@ -28,24 +67,38 @@ void Dropout::openCL(cl::Context& _context)
 
 void Dropout::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch)
 {
-    rands.resizeAs(_inputBatch);
     output.resizeAs(_inputBatch);
-
-    rands.openCL(_commandQueue.getContext());
     output.openCL(_commandQueue.getContext());
 
-    rands.randomize(0.0f, 1.0f);
-    _commandQueue.enqueueWrite(rands);
+    if (!training)
+    {
+        _commandQueue.enqueueCopy(_inputBatch.getBuffer(), output.getBuffer(), _inputBatch.nElements() * sizeof(Tensor::value_type));
+        return;
+    }
+
+    // The mask is drawn on the device: nothing is uploaded
+    size_t words = (_inputBatch.nElements() + 31) / 32;
+
+    mask.resize({words});
+    mask.openCL(_commandQueue.getContext());
 
-    int inputWidth = _inputBatch.getStride(0);
+    int size = _inputBatch.nElements();
+    uint32_t run0 = uint32_t(run), run1 = uint32_t(run >> 32);
 
     forwardKernel.setArg(0, output);
     forwardKernel.setArg(1,_inputBatch);
-    forwardKernel.setArg(2, inputWidth);
-    forwardKernel.setArg(3, rands);
-    forwardKernel.setArg(4, rate);
-
-    _commandQueue.enqueueKernel(forwardKernel, { _inputBatch.size(0) });
+    forwardKernel.setArg(2, mask);
+    forwardKernel.setArg(3, size);
+    forwardKernel.setArg(4, key[0]);
+    forwardKernel.setArg(5, key[1]);
+    forwardKernel.setArg(6, run0);
+    forwardKernel.setArg(7, run1);
+    forwardKernel.setArg(8, threshold());
+    forwardKernel.setArg(9, scale());
+
+    _commandQueue.enqueueKernel(forwardKernel, { words });
+
+    run++;
 }
 
 void Dropout::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -53,34 +106,78 @@ void Dropout::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatc
     inputGrad.resizeAs(_inputBatch);
     inputGrad.openCL(_commandQueue.getContext());
 
-    int inputWidth = _inputBatch.getStride(0);
-
     backwardKernel.setArg(0, inputGrad);
-    backwardKernel.setArg(1, output);
-    backwardKernel.setArg(2,_outputGradBatch);
-    backwardKernel.setArg(3, sizeof(int), &inputWidth);
+    backwardKernel.setArg(1,_outputGradBatch);
+    backwardKernel.setArg(2, mask);
+    backwardKernel.setArg(3, scale());
 
-    _commandQueue.enqueueKernel(backwardKernel, {_inputBatch.size(0)});
+    _commandQueue.enqueueKernel(backwardKernel, { _inputBatch.nElements() });
 }
 
 #else
-void Dropout::feedForward(const Tensor& _input)
+Layer* Dropout::clone() const
 {
-    output = _input;
+    Dropout* layer = new Dropout(*this);
+    layer->seed();
 
-    for (unsigned i(0) ; i < _input.nElements() ; i++)
-        if (Random::next<Tensor::value_type>() < rate)
-            output[i] = 0.0;
+    return layer;
 }
 
+void Dropout::feedForward(const Tensor& _input)
+{
+    // Kept units are scaled during training, so inference is the identity
+    if (!training)
+    {
+        output = _input;
+        return;
+    }
+
+    const size_t size = _input.nElements();
+    const uint32_t dropThreshold = threshold();
+    const Tensor::value_type keepScale = scale();
+
+    output.resizeAs(_input);
+    mask.resize((size + 31) / 32);
+
+    // Same stream as dropout.cl: the word w is drawn from the counters (8w + k, run) for k < 8
+    for (size_t w(0) ; w < mask.size() ; w++)
+    {
+        uint32_t bits = 0;
+
+        for (size_t k(0) ; k < 8 ; k++)
+        {
+            uint64_t counter = 8*w + k;
+            uint32_t r[4] = { uint32_t(counter), uint32_t(counter >> 32), uint32_t(run), uint32_t(run >> 32) };
+            philox(r, key);
+
+            for (size_t j(0) ; j < 4 && 32*w + 4*k + j < size ; j++)
+            {
+                size_t i = 32*w + 4*k + j;
+
+                if (r[j] >= dropThreshold)
+                {
+                    bits |= 1u << (4*k + j);
+                    output[i] = keepScale * _input[i];
+                }
+                else
+                    output[i] = 0.0f;
+            }
+        }
+
+        mask[w] = bits;
+    }
+
+    run++;
+}
 
 void Dropout::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
-    inputGrad = _outputGrad;
+    const Tensor::value_type keepScale = scale();
+
+    inputGrad.resizeAs(_input);
 
-    for (unsigned i(0) ; i < _input.nElements() ; i++)
-        if (output[i] == 0.0f)
-            inputGrad[i] = 0.0f;
+    for (size_t i(0) ; i < _input.nElements() ; i++)
+        inputGrad[i] = ((mask[i / 32] >> (i % 32)) & 1u)? keepScale * _outputGrad[i]: 0.0f;
 }
 #endif // USE_OPENCL
 
@@ -1,6 +1,8 @@
 #include "RNA/Layers/Layer.h"
+#include "Utility/Error.h"
 
 #include <fstream>
+#include <utility>
 
 namespace rna
 {
@@ -28,6 +30,23 @@ void Layer::releaseCL()
 	forwardKernel.release();
 	backwardKernel.release();
 }
+#else
+Layer* Layer::clone() const
+{
+    Error::add(ErrorType::USER_ERROR, "Layer::clone => " + type + " can not be cloned");
+
+    return nullptr;
+}
+
+void Layer::swapOutput(Tensor& _buffer)
+{
+    std::swap(output, _buffer);
+}
+
+void Layer::swapInputGrad(Tensor& _buffer)
+{
+    std::swap(inputGrad, _buffer);
+}
 #endif // USE_OPENCL
 
 const Tensor& Layer::getOutput() const
@@ -1,4 +1,7 @@
 #include "RNA/Layers/Linear.h"
+#include "RNA/Layers/activations.h"
+#include "RNA/Maths/gemm.h"
+#include "RNA/kernels.h"
 #include "Utility/Error.h"
 
 #include <fstream>
@@ -7,18 +10,23 @@
 namespace rna
 {
 
-Linear::Linear(size_t _inputSize, size_t _outputSize):
+Linear::Linear(size_t _inputSize, size_t _outputSize, bool _randomize):
     Layer("Linear"),
-    weights{_outputSize, _inputSize}, bias{_outputSize}
+    weights{_outputSize, _inputSize}, bias{_outputSize},
+    activation(nullptr),
+    precision(Precision::SINGLE), training(true), roundedWeightsValid(false)
 {
-    randomize();
+    if (_randomize)
+        randomize();
 
     weightsGrad.resizeAs(weights);
     biasGrad.resizeAs(bias);
 }
 
 Linear::Linear(std::ifstream& _file):
-    Layer("Linear")
+    Layer("Linear"),
+    activation(nullptr),
+    precision(Precision::SINGLE), training(true), roundedWeightsValid(false)
 {
     size_t inputSize, outputSize;
     _file >> inputSize >> outputSize;
@@ -43,18 +51,109 @@ void Linear::randomize()
 {
     weights.randomize(Layer::WEIGHT_INIT_MIN, Layer::WEIGHT_INIT_MAX);
     bias.randomize(Layer::BIAS_INIT_MIN, Layer::BIAS_INIT_MAX);
+
+    roundedWeightsValid = false;
+}
+
+void Linear::setPrecision(Precision _precision)
+{
+    #ifdef USE_OPENCL
+    if (_precision != Precision::SINGLE)
+    {
+        Error::add(ErrorType::USER_ERROR, "Linear::setPrecision => Reduced precisions are only implemented on CPU");
+        return;
+    }
+    #endif // USE_OPENCL
+
+    if (_precision == Precision::INT8)
+    {
+        Error::add(ErrorType::USER_ERROR, "Linear::setPrecision => int8 needs a calibrated input range, see Network::quantize");
+        return;
+    }
+
+    precision = _precision;
+    roundedWeightsValid = false;
+}
+
+void Linear::setActivation(Activation* _activation)
+{
+    if (activation)
+        activation->fusedLayer = nullptr;
+
+    activation = _activation;
+
+    if (activation)
+        activation->fusedLayer = this;
+}
+
+Activation* Linear::getActivation() const
+{
+    return activation;
+}
+
+const Tensor& Linear::getActivationGrad() const
+{
+    return activationGrad;
 }
 
 #ifdef USE_OPENCL
+namespace
+{
+
+// Codes of the activations implemented in linear.cl, -1 for the others
+int activationCode(const Activation* _activation)
+{
+    if (!_activation)
+        return 0;
+
+    const std::string& type = _activation->getType();
+
+    if (type == "Tanh")
+        return 1;
+    if (type == "Sigmoid")
+        return 2;
+    if (type == "ReLU")
+        return 3;
+    if (type == "ELU")
+        return 4;
+
+    return -1;
+}
+
+Tensor::value_type activationAlpha(const Activation* _activation)
+{
+    const ELU* elu = dynamic_cast<const ELU*>(_activation);
+
+    return elu? elu->getAlpha(): 0.0f;
+}
+
+// The products of linear.cl have one work-item per row and 4 columns of the result, in work-groups of any shape:
+// the sizes are rounded up so that the runtime can pick a large work-group, rows only past 16 to keep small batches cheap
+std::vector<size_t> globalSize(size_t _rows, size_t _columns)
+{
+    size_t rows = (_rows < 16)? _rows: (_rows + 15) / 16 * 16;
+    size_t columns = ((_columns + 3) / 4 + 7) / 8 * 8;
+
+    return { rows, columns };
+}
+
+}
+
+bool Linear::canFuse(const Activation* _activation)
+{
+    return activationCode(_activation) >= 0;
+}
+
 void Linear::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/linear.cl");
+    auto& p = getProgram(_context, "linear.cl");
 
     forwardKernel.create(p, "feedForwardLinear");
     backwardKernel.create(p, "backpropLinear");
 
     weightsGradKernel.create(p, "weightsGradLinear");
     biasGradKernel.create(p, "biasGradLinear");
+    activationGradKernel.create(p, "activationGradLinear");
 
     weights.openCL(_context);
     bias.openCL(_context);
@@ -63,15 +162,38 @@ void Linear::openCL(cl::Context& _context)
     biasGrad.openCL(_context);
 
 
+    int inputWidth = weights.size(1);
+    int outputWidth = weights.size(0);
+
     forwardKernel.setArg(2, weights);
     forwardKernel.setArg(3, bias);
-    forwardKernel.setArg(4, weights.size(1));
+    forwardKernel.setArg(5, inputWidth);
+    forwardKernel.setArg(6, outputWidth);
 
     backwardKernel.setArg(2, weights);
-    backwardKernel.setArg(3, weights.size(0));
+    backwardKernel.setArg(4, inputWidth);
+    backwardKernel.setArg(5, outputWidth);
 
     weightsGradKernel.setArg(0, weightsGrad);
+    weightsGradKernel.setArg(4, inputWidth);
+    weightsGradKernel.setArg(5, outputWidth);
+
     biasGradKernel.setArg(0, biasGrad);
+
+    // The activation only changes through Network::setFusion, which runs openCL again
+    int code = activationCode(activation);
+    if (code < 0)
+    {
+        Error::add(ErrorType::USER_ERROR, "Linear::openCL => Activation can not be fused: " + activation->getType());
+        code = 0;
+    }
+    Tensor::value_type alpha = activationAlpha(activation);
+
+    forwardKernel.setArg(7, code);
+    forwardKernel.setArg(8, alpha);
+
+    activationGradKernel.setArg(3, code);
+    activationGradKernel.setArg(4, alpha);
 }
 
 void Linear::releaseCL()
@@ -80,6 +202,7 @@ void Linear::releaseCL()
 
     weightsGradKernel.release();
     biasGradKernel.release();
+    activationGradKernel.release();
 }
 
 void Linear::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch)
@@ -87,17 +210,36 @@ void Linear::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBa
     output.resize({_inputBatch.size(0), bias.size(0)});
     output.openCL(_commandQueue.getContext());
 
+    int batchSize = _inputBatch.size(0);
+
     forwardKernel.setArg(0, output);
     forwardKernel.setArg(1,_inputBatch);
+    forwardKernel.setArg(4, batchSize);
 
-    _commandQueue.enqueueKernel(forwardKernel, output.size());
+    _commandQueue.enqueueKernel(forwardKernel, globalSize(output.size(0), output.size(1)));
 }
 
 void Linear::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
 {
+    const Tensor* outputGrad = &_outputGradBatch;
+
+    if (activation)
+    {
+        activationGrad.resizeAs(_outputGradBatch);
+        activationGrad.openCL(_commandQueue.getContext());
+
+        activationGradKernel.setArg(0, activationGrad);
+        activationGradKernel.setArg(1, output);
+        activationGradKernel.setArg(2,_outputGradBatch);
+
+        _commandQueue.enqueueKernel(activationGradKernel, { activationGrad.nElements() });
+
+        outputGrad = &activationGrad;
+    }
+
     // Start with paramsGrad to enqueue barrier on inputGrad
-    updateParamsGrad(_commandQueue, _inputBatch, _outputGradBatch);
-    updateInputGrad(_commandQueue, _inputBatch, _outputGradBatch);
+    updateParamsGrad(_commandQueue, _inputBatch, *outputGrad);
+    updateInputGrad(_commandQueue, _inputBatch, *outputGrad);
 }
 
 void Linear::updateInputGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -105,66 +247,167 @@ void Linear::updateInputGrad(cl::CommandQueue& _commandQueue, const Tensor& _inp
     inputGrad.resizeAs({_outputGradBatch.size(0), weights.size(1)});
     inputGrad.openCL(_commandQueue.getContext());
 
+    int batchSize = _outputGradBatch.size(0);
+
     backwardKernel.setArg(0, inputGrad);
     backwardKernel.setArg(1,_outputGradBatch);
+    backwardKernel.setArg(3, batchSize);
 
-    _commandQueue.enqueueKernel(backwardKernel, inputGrad.size());
+    _commandQueue.enqueueKernel(backwardKernel, globalSize(inputGrad.size(0), inputGrad.size(1)));
 }
 
 void Linear::updateParamsGrad(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
 {
+    int batchSize = _outputGradBatch.size(0);
+
     // weightsGrad
     weightsGradKernel.setArg(1,_outputGradBatch);
     weightsGradKernel.setArg(2,_inputBatch);
-    weightsGradKernel.setArg(3,_outputGradBatch.size(0));
+    weightsGradKernel.setArg(3, batchSize);
 
-    _commandQueue.enqueueKernel(weightsGradKernel, weightsGrad.size());
+    _commandQueue.enqueueKernel(weightsGradKernel, globalSize(weightsGrad.size(0), weightsGrad.size(1)));
 
     // biasGrad
     biasGradKernel.setArg(1,_outputGradBatch);
-    biasGradKernel.setArg(2,_outputGradBatch.size(0));
+    biasGradKernel.setArg(2, batchSize);
 
     _commandQueue.enqueueKernel(biasGradKernel, biasGrad.size());
 }
 
 #else
+bool Linear::canFuse(const Activation*)
+{
+    // The epilogue goes through Activation::f, which every activation implements
+    return true;
+}
+
+void Linear::quantize(Tensor::value_type _inputRange)
+{
+    precision = Precision::INT8;
+    inputScale = (_inputRange > 0.0f)? _inputRange / 127.0f: 1.0f;
+
+    roundedWeightsValid = false;
+}
+
+Layer* Linear::clone() const
+{
+    Linear* layer = new Linear(*this);
+    layer->activation = nullptr; // Fused again when the clone is added to a network
+
+    return layer;
+}
+
+void Linear::setTraining(bool _training)
+{
+    training = _training;
+}
+
 void Linear::feedForward(const Tensor& _input)
 {
-    if (_input.nDimensions() == 1)
+    size_t inputSize = weights.size(1), outputSize = weights.size(0);
+
+    if (_input.nDimensions() != 1 && _input.nDimensions() != 2)
+        return;
+
+    size_t batchSize = (_input.nDimensions() == 2)? _input.size(0): 1;
+
+    if (_input.nDimensions() == 2)
+        output.resize({batchSize, outputSize});
+    else
+        output.resize({outputSize});
+
+    // Bias and activation are applied to each block of the output while it is still in cache
+    auto epilogue = [this](Tensor::value_type* _block, size_t _ld, size_t, size_t _column, size_t _rows, size_t _columns)
     {
-        mulmv(output, weights, _input);
-        output += bias;
+        const Tensor::value_type* b = bias.data() + _column;
+
+        for (size_t i(0) ; i < _rows ; i++)
+        {
+            Tensor::value_type* row = _block + i*_ld;
+
+            for (size_t j(0) ; j < _columns ; j++)
+                row[j] += b[j];
+
+            if (activation)
+                activation->f(row, row, _columns);
+        }
+    };
+
+    if (precision == Precision::INT8 && !training)
+    {
+        updateRoundedWeights();
+
+        int8Input.resize(batchSize * int8Weights.stride);
+        quantizeRows(int8Input.data(), int8Weights.stride, _input.data(), batchSize, inputSize, inputScale);
+
+        gemmInt8(batchSize, int8Input.data(), inputScale, int8Weights, output.data(), outputSize, epilogue);
     }
-    else if (_input.nDimensions() == 2)
+    else if (precision == Precision::BFLOAT16 && !training)
     {
-        mulmmt(output, _input, weights);
+        updateRoundedWeights();
 
-        for (unsigned i(0); i < output.size(0); i++)
-            for (unsigned j(0); j < output.size(1); j++)
-                output(i, j) += bias(j);
+        gemm(false, true, batchSize, outputSize, inputSize,
+             1.0f, _input.data(), inputSize, halfWeights.data(), inputSize,
+             0.0f, output.data(), outputSize, epilogue);
     }
+    else
+        gemm(false, true, batchSize, outputSize, inputSize,
+             1.0f, _input.data(), inputSize, weights.data(), inputSize,
+             0.0f, output.data(), outputSize, epilogue);
 }
 
 void Linear::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
-    if (_input.nDimensions() == 1)
-    {
-        mulmv(inputGrad, weights.getTranspose(), _outputGrad);
+    size_t inputSize = weights.size(1), outputSize = weights.size(0);
 
-        weightsGrad.addOuterProduct(_outputGrad, _input);
-        biasGrad += _outputGrad;
-    }
-    else if (_input.nDimensions() == 2)
+    if (activation)
     {
-        mulmm(inputGrad, _outputGrad, weights);
+        activationGrad.resizeAs(_outputGrad);
+        activation->df(activationGrad.data(), output.data(), _outputGrad.data(), activationGrad.nElements());
+    }
+
+    const Tensor& outputGrad = activation? activationGrad: _outputGrad;
+
+    if (_input.nDimensions() != 1 && _input.nDimensions() != 2)
+        return;
+
+    size_t batchSize = (_input.nDimensions() == 2)? _input.size(0): 1;
+
+    if (_input.nDimensions() == 2)
+        inputGrad.resize({batchSize, inputSize});
+    else
+        inputGrad.resize({inputSize});
+
+    // A single input is a batch of one: op(A) is then a row vector and gemm falls back to gemv
+    gemm(false, false, batchSize, inputSize, outputSize,
+         1.0f, outputGrad.data(), outputSize, weights.data(), inputSize,
+         0.0f, inputGrad.data(), inputSize);
 
-        Tensor temp; mulmtm(temp, _outputGrad, _input);
-        weightsGrad += temp;
+    gemm(true, false, outputSize, inputSize, batchSize,
+         1.0f, outputGrad.data(), outputSize, _input.data(), inputSize,
+         1.0f, weightsGrad.data(), inputSize);
 
-        for (unsigned i(0) ; i < _outputGrad.size(0) ; i++)
-            for (unsigned j(0) ; j < _outputGrad.size(1) ; j++)
-                biasGrad(j) += _outputGrad(i, j);
+    addRows(biasGrad.data(), outputGrad.data(), batchSize, outputSize);
+
+    // Weights are about to be updated by the optimizer
+    roundedWeightsValid = false;
+}
+
+void Linear::updateRoundedWeights()
+{
+    if (roundedWeightsValid)
+        return;
+
+    if (precision == Precision::INT8)
+        int8Weights.quantize(weights.data(), weights.size(0), weights.size(1));
+
+    else
+    {
+        halfWeights.resize(weights.nElements());
+        toBFloat16(halfWeights.data(), weights.data(), weights.nElements());
     }
+
+    roundedWeightsValid = true;
 }
 #endif // USE_OPENCL
 
@@ -185,6 +428,8 @@ void Linear::setParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _par
     // weights
         weights = *_params.back();
         _params.pop_back();
+
+    roundedWeightsValid = false;
 }
 
 void Linear::getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad)
@@ -196,6 +441,17 @@ void Linear::getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _par
     _paramsGrad.push_back(&biasGrad);
 }
 
+void Linear::parametersChanged()
+{
+    // Rebuilt from the new weights by the next inference
+    halfWeights.clear();
+    #ifndef USE_OPENCL
+    int8Weights = Int8Matrix();
+    #endif // USE_OPENCL
+
+    roundedWeightsValid = false;
+}
+
 void Linear::saveToFile(std::ofstream& _file) const
 {
     Layer::saveToFile(_file);
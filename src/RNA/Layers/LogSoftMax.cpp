@@ -1,4 +1,5 @@
 #include "RNA/Layers/LogSoftMax.h"
+#include "RNA/kernels.h"
 
 #include <cmath>
 
@@ -8,7 +9,7 @@ namespace rna
 #ifdef USE_OPENCL
 void LogSoftMax::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/logSoftMax.cl");
+    auto& p = getProgram(_context, "logSoftMax.cl");
 
     forwardKernel.create(p, "feedForwardLogSoftMax");
     backwardKernel.create(p, "backpropLogSoftMax");
@@ -41,6 +42,11 @@ void LogSoftMax::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputB
 }
 
 #else
+Layer* LogSoftMax::clone() const
+{
+    return new LogSoftMax(*this);
+}
+
 void LogSoftMax::feedForward(const Tensor& _input)
 {
     output.resizeAs(_input);
@@ -1,4 +1,5 @@
 #include "RNA/Layers/MaxPooling.h"
+#include "RNA/kernels.h"
 
 #include <cfloat>
 #include <fstream>
@@ -18,15 +19,36 @@ MaxPooling::MaxPooling(std::ifstream& _file):
 }
 
 #ifdef USE_OPENCL
+static_assert(sizeof(cl_int) == sizeof(Tensor::value_type), "MaxPooling stores int32 indices in the elements of a Tensor");
+
+void MaxPooling::DeviceIndices::resizeAs(const Tensor& _output, cl::Context& _context)
+{
+    storage.resizeAs(_output);
+    storage.openCL(_context);
+}
+
+void MaxPooling::DeviceIndices::setArg(cl::Kernel& _kernel, unsigned _index) const
+{
+    _kernel.setArg(_index, storage);
+}
+
+size_t MaxPooling::DeviceIndices::size(size_t _dimension) const
+{
+    return storage.size(_dimension);
+}
+
 void MaxPooling::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/maxPooling.cl");
+    auto& p = getProgram(_context, "maxPooling.cl");
 
     forwardKernel.create(p, "feedForwardMaxPooling");
     backwardKernel.create(p, "backpropMaxPooling");
 
     forwardKernel.setArg(3, poolWidth);
     forwardKernel.setArg(4, poolHeight);
+
+    backwardKernel.setArg(3, poolWidth);
+    backwardKernel.setArg(4, poolHeight);
 }
 
 void MaxPooling::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch)
@@ -34,55 +56,74 @@ void MaxPooling::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inp
     output.resize( {_inputBatch.size(0), _inputBatch.size(1), _inputBatch.size(2) / poolWidth, _inputBatch.size(3) / poolHeight} );
     output.openCL(_commandQueue.getContext());
 
-    indices.resizeAs(output);
-    indices.openCL(_commandQueue.getContext());
+    indices.resizeAs(output, _commandQueue.getContext());
+
+    int inputWidth = _inputBatch.size(2);
+    int inputHeight = _inputBatch.size(3);
 
     forwardKernel.setArg(0, output);
-    forwardKernel.setArg(1, indices);
+    indices.setArg(forwardKernel, 1);
     forwardKernel.setArg(2,_inputBatch);
+    forwardKernel.setArg(5, inputWidth);
+    forwardKernel.setArg(6, inputHeight);
 
-    for (int i(0) ; i < (int)_inputBatch.size(0) ; i++)
-    {
-        forwardKernel.setArg(5, i);
-        _commandQueue.enqueueKernel(forwardKernel, {indices.size(1), indices.size(2), indices.size(3)});
-    }
+    _commandQueue.enqueueKernel(forwardKernel, {indices.size(0)*indices.size(1), indices.size(2), indices.size(3)});
 }
 
 void MaxPooling::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
 {
     inputGrad.resizeAs(_inputBatch);
     inputGrad.openCL(_commandQueue.getContext());
-    inputGrad.fill(0.0);
-    _commandQueue.enqueueWrite(inputGrad);
 
-    // inputGrad
+    int outputWidth = indices.size(2);
+    int outputHeight = indices.size(3);
+
+    // inputGrad: gathered on the device, cells outside of the argmax are written with zeros
     backwardKernel.setArg(0, inputGrad);
     backwardKernel.setArg(1,_outputGradBatch);
-    backwardKernel.setArg(2, indices);
-    backwardKernel.setArg(3, _inputBatch.size(0));
+    indices.setArg(backwardKernel, 2);
+    backwardKernel.setArg(5, outputWidth);
+    backwardKernel.setArg(6, outputHeight);
 
-    _commandQueue.enqueueKernel(backwardKernel, {indices.size(1), indices.size(2), indices.size(3)});
+    _commandQueue.enqueueKernel(backwardKernel, {inputGrad.size(0)*inputGrad.size(1), inputGrad.size(2), inputGrad.size(3)});
 }
 
 #else
+Layer* MaxPooling::clone() const
+{
+    return new MaxPooling(*this);
+}
+
 void MaxPooling::feedForward(const Tensor& _input)
 {
-    output.resize( {_input.size(0), _input.size(1) / poolWidth, _input.size(2) / poolHeight} );
-    indices.resizeAs(output);
+    // Works on (channels x width x height) samples as well as on minibatches of them
+    size_t w = _input.nDimensions() - 2, h = w + 1;
+
+    coords_t outputSize = _input.size();
+        outputSize[w] /= poolWidth;
+        outputSize[h] /= poolHeight;
+
+    output.resize(outputSize);
+    indices.resize(output.nElements());
 
-    for (size_t c(0) ; c < output.size(0) ; c++)
-    for (size_t i(0) ; i < output.size(1) ; i++)
+    size_t inputPlane = _input.size(w) * _input.size(h);
+    size_t planes = output.nElements() / (output.size(w) * output.size(h));
+
+    size_t outputIndex = 0;
+
+    for (size_t p(0) ; p < planes ; p++)
+    for (size_t i(0) ; i < output.size(w) ; i++)
     {
-        for (size_t j(0) ; j < output.size(2) ; j++)
+        for (size_t j(0) ; j < output.size(h) ; j++)
         {
-            float maxInput = FLT_MIN;
-            int maxIndex = -1;
+            float maxInput = -FLT_MAX;
+            size_t maxIndex = 0;
 
             for (size_t u = 0 ; u < poolWidth ; ++u)
             {
                 for (size_t v = 0 ; v < poolHeight ; ++v)
                 {
-                    int inputIndex = _input.getIndex({c, poolWidth*i + u, poolHeight*j + v});
+                    size_t inputIndex = p*inputPlane + (poolWidth*i + u)*_input.size(h) + poolHeight*j + v;
 
                     if (_input[inputIndex] > maxInput)
                     {
@@ -92,8 +133,10 @@ void MaxPooling::feedForward(const Tensor& _input)
                 }
             }
 
-            output(c, i, j) = maxInput;
-            indices(c, i, j) = maxIndex;
+            output[outputIndex] = maxInput;
+            indices[outputIndex] = maxIndex;
+
+            outputIndex++;
         }
     }
 }
@@ -103,14 +146,8 @@ void MaxPooling::backprop(const Tensor& _input, const Tensor& _outputGrad)
     inputGrad.resizeAs(_input);
     inputGrad.fill(0.0);
 
-    for (unsigned c(0) ; c < indices.size(0) ; c++)
-    for (unsigned i(0) ; i < indices.size(1) ; i++)
-    {
-        for (unsigned j(0) ; j < indices.size(2) ; j++)
-        {
-            inputGrad[indices(c, i, j)] = _outputGrad(c, i, j);
-        }
-    }
+    for (size_t i(0) ; i < indices.size() ; i++)
+        inputGrad[indices[i]] = _outputGrad[i];
 }
 #endif // USE_OPENCL
 
@@ -60,6 +60,11 @@ void Reshape::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatc
 }
 
 #else
+Layer* Reshape::clone() const
+{
+    return new Reshape(*this);
+}
+
 void Reshape::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
     inputGrad = _outputGrad;
@@ -1,4 +1,7 @@
 #include "RNA/Layers/activations.h"
+#include "RNA/Layers/Linear.h"
+#include "RNA/Maths/activations.h"
+#include "RNA/kernels.h"
 #include "Utility/Error.h"
 
 #include <cmath>
@@ -20,6 +23,21 @@ Tensor::value_type dSigmoid(Tensor::value_type _x)
 
 
 /// Activation
+const Tensor& Activation::getOutput() const
+{
+    return fusedLayer? fusedLayer->getOutput(): output;
+}
+
+const Tensor& Activation::getInputGrad() const
+{
+    return fusedLayer? fusedLayer->getActivationGrad(): inputGrad;
+}
+
+const Linear* Activation::getFusedLayer() const
+{
+    return fusedLayer;
+}
+
 #ifdef USE_OPENCL
 void Activation::feedForward(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch)
 {
@@ -54,16 +72,14 @@ void Activation::feedForward(const Tensor& _input)
 {
     output.resizeAs(_input);
 
-    for (unsigned i(0) ; i < _input.nElements() ; i++)
-        output[i] = f(_input[i]);
+    f(output.data(), _input.data(), _input.nElements());
 }
 
 void Activation::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
     inputGrad.resizeAs(_input);
 
-    for (unsigned i(0) ; i < inputGrad.nElements() ; i++)
-        inputGrad[i] = df(_input[i]) * _outputGrad[i];
+    df(inputGrad.data(), output.data(), _outputGrad.data(), _input.nElements());
 }
 #endif // USE_OPENCL
 
@@ -71,46 +87,84 @@ void Activation::backprop(const Tensor& _input, const Tensor& _outputGrad)
 #ifdef USE_OPENCL
 void Tanh::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/activations.cl");
+    auto& p = getProgram(_context, "activations.cl");
 
     forwardKernel.create(p, "feedForwardTanh");
     backwardKernel.create(p, "backpropTanh");
 }
+
+#else
+Layer* Tanh::clone() const
+{
+    return new Tanh(*this);
+}
+
+void Tanh::f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n)
+{
+    tanhForward(_output, _input, _n);
+}
+
+void Tanh::df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n)
+{
+    tanhBackward(_inputGrad, _output, _outputGrad, _n);
+}
 #endif // USE_OPENCL
 
-Tensor::value_type Tanh::f(Tensor::value_type _value)
+
+/// Sigmoid
+#ifdef USE_OPENCL
+void Sigmoid::openCL(cl::Context& _context)
+{
+    auto& p = getProgram(_context, "activations.cl");
+
+    forwardKernel.create(p, "feedForwardSigmoid");
+    backwardKernel.create(p, "backpropSigmoid");
+}
+
+#else
+Layer* Sigmoid::clone() const
 {
-    return tanh(_value);
+    return new Sigmoid(*this);
 }
 
-Tensor::value_type Tanh::df(Tensor::value_type _value)
+void Sigmoid::f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n)
 {
-    Tensor::value_type t = tanh(_value);
+    sigmoidForward(_output, _input, _n);
+}
 
-    return Tensor::value_type(1.0) - t*t;
+void Sigmoid::df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n)
+{
+    sigmoidBackward(_inputGrad, _output, _outputGrad, _n);
 }
+#endif // USE_OPENCL
 
 
 /// ReLU
 #ifdef USE_OPENCL
 void ReLU::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/activations.cl");
+    auto& p = getProgram(_context, "activations.cl");
 
     forwardKernel.create(p, "feedForwardReLU");
     backwardKernel.create(p, "backpropReLU");
 }
-#endif // USE_OPENCL
 
-Tensor::value_type ReLU::f(Tensor::value_type _value)
+#else
+Layer* ReLU::clone() const
+{
+    return new ReLU(*this);
+}
+
+void ReLU::f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n)
 {
-    return std::max(_value, Tensor::value_type(0.0));
+    reluForward(_output, _input, _n);
 }
 
-Tensor::value_type ReLU::df(Tensor::value_type _value)
+void ReLU::df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n)
 {
-    return (_value < 0.0)? 0.0: 1.0;
+    reluBackward(_inputGrad, _output, _outputGrad, _n);
 }
+#endif // USE_OPENCL
 
 
 /// ELU
@@ -123,7 +177,7 @@ ELU::ELU(std::ifstream& _file):
 #ifdef USE_OPENCL
 void ELU::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/activations.cl");
+    auto& p = getProgram(_context, "activations.cl");
 
     forwardKernel.create(p, "feedForwardELU");
     backwardKernel.create(p, "backpropELU");
@@ -131,18 +185,24 @@ void ELU::openCL(cl::Context& _context)
     forwardKernel.setArg(3, alpha);
     backwardKernel.setArg(5, alpha);
 }
-#endif // USE_OPENCL
 
-Tensor::value_type ELU::f(Tensor::value_type _value)
+#else
+Layer* ELU::clone() const
 {
-    return _value < 0.0? alpha * (exp(_value)-1.0): _value;
+    return new ELU(*this);
 }
 
-Tensor::value_type ELU::df(Tensor::value_type _value)
+void ELU::f(Tensor::value_type* _output, const Tensor::value_type* _input, size_t _n)
 {
-    return _value < 0.0? alpha * exp(_value): 1.0;
+    eluForward(_output, _input, _n, alpha);
 }
 
+void ELU::df(Tensor::value_type* _inputGrad, const Tensor::value_type* _output, const Tensor::value_type* _outputGrad, size_t _n)
+{
+    eluBackward(_inputGrad, _output, _outputGrad, _n, alpha);
+}
+#endif // USE_OPENCL
+
 void ELU::saveToFile(std::ofstream& _file) const
 {
     Layer::saveToFile(_file);
@@ -150,4 +210,9 @@ void ELU::saveToFile(std::ofstream& _file) const
     _file << alpha << std::endl;
 }
 
+Tensor::value_type ELU::getAlpha() const
+{
+    return alpha;
+}
+
 }
@@ -0,0 +1,92 @@
+#include "RNA/Losses/CrossEntropy.h"
+#include "RNA/kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rna
+{
+
+Tensor::value_type CrossEntropy::getLoss(const Tensor& _estimation, const Tensor& _target) const
+{
+    size_t batchSize = (_estimation.nDimensions() == 1)? 1: _estimation.size(0);
+    size_t width = _estimation.nElements() / batchSize;
+
+    Tensor::value_type loss = 0.0;
+
+    for (size_t i(0) ; i < batchSize ; i++)
+    {
+        const Tensor::value_type* logits = _estimation.data() + i*width;
+
+        Tensor::value_type maxLogit = *std::max_element(logits, logits + width);
+        Tensor::value_type sum = 0.0;
+
+        for (size_t j(0) ; j < width ; j++)
+            sum += exp(logits[j] - maxLogit);
+
+        loss += maxLogit + log(sum) - logits[(size_t)_target[i]];
+    }
+
+    return loss;
+}
+
+#ifdef USE_OPENCL
+void CrossEntropy::openCL(cl::Context& _context)
+{
+    auto& p = getProgram(_context, "losses.cl");
+
+    gradientKernel.create(p, "gradientCrossEntropy");
+}
+
+const Tensor& CrossEntropy::getGradient(cl::CommandQueue& _commandQueue, const Tensor& _estimationBatch, const Tensor& _targetBatch)
+{
+    gradient.resize(_estimationBatch.size());
+    gradient.openCL(_commandQueue.getContext());
+
+    _targetBatch.openCL(_commandQueue.getContext());
+
+    gradientKernel.setArg(0, gradient);
+    gradientKernel.setArg(1,_estimationBatch);
+    gradientKernel.setArg(2,_targetBatch);
+    gradientKernel.setArg(3,_estimationBatch.size(1));
+
+    _commandQueue.enqueueKernel(gradientKernel, { _estimationBatch.size(0) });
+
+    return gradient;
+}
+
+#else
+const Tensor& CrossEntropy::getGradient(const Tensor& _estimation, const Tensor& _target)
+{
+    gradient.resize(_estimation.size());
+
+    size_t batchSize = (_estimation.nDimensions() == 1)? 1: _estimation.size(0);
+    size_t width = _estimation.nElements() / batchSize;
+
+    for (size_t i(0) ; i < batchSize ; i++)
+    {
+        const Tensor::value_type* logits = _estimation.data() + i*width;
+        Tensor::value_type* grad = gradient.data() + i*width;
+
+        Tensor::value_type maxLogit = *std::max_element(logits, logits + width);
+        Tensor::value_type sum = 0.0;
+
+        for (size_t j(0) ; j < width ; j++)
+        {
+            grad[j] = exp(logits[j] - maxLogit);
+            sum += grad[j];
+        }
+
+        Tensor::value_type invSum = Tensor::value_type(1.0) / sum;
+
+        for (size_t j(0) ; j < width ; j++)
+            grad[j] *= invSum;
+
+        grad[(size_t)_target[i]] -= Tensor::value_type(1.0);
+    }
+
+    return gradient;
+}
+#endif // USE_OPENCL
+
+}
@@ -1,4 +1,5 @@
 #include "RNA/Losses/Huber.h"
+#include "RNA/kernels.h"
 
 #include <cmath>
 
@@ -26,7 +27,7 @@ Tensor::value_type Huber::getLoss(const Tensor& _estimation, const Tensor& _targ
 #ifdef USE_OPENCL
 void Huber::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/losses.cl");
+    auto& p = getProgram(_context, "losses.cl");
 
     gradientKernel.create(p, "gradientHuber");
 }
@@ -51,7 +52,7 @@ const Tensor& Huber::getGradient(cl::CommandQueue& _commandQueue, const Tensor&
 #else
 const Tensor& Huber::getGradient(const Tensor& _estimation, const Tensor& _target)
 {
-    gradient.resize({_estimation.nElements()});
+    gradient.resize(_estimation.size());
 
     for (unsigned i(0) ; i < _estimation.nElements() ; i++)
     {
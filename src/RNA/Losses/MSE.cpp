@@ -1,4 +1,5 @@
 #include "RNA/Losses/MSE.h"
+#include "RNA/kernels.h"
 
 namespace rna
 {
@@ -11,7 +12,7 @@ Tensor::value_type MSE::getLoss(const Tensor& _estimation, const Tensor& _target
 #ifdef USE_OPENCL
 void MSE::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/losses.cl");
+    auto& p = getProgram(_context, "losses.cl");
 
     gradientKernel.create(p, "gradientMSE");
 }
@@ -1,4 +1,5 @@
 #include "RNA/Losses/NLL.h"
+#include "RNA/kernels.h"
 
 namespace rna
 {
@@ -21,7 +22,7 @@ Tensor::value_type NLL::getLoss(const Tensor& _estimation, const Tensor& _target
 #ifdef USE_OPENCL
 void NLL::openCL(cl::Context& _context)
 {
-    auto& p = _context.getProgram("Kernels/losses.cl");
+    auto& p = getProgram(_context, "losses.cl");
 
     gradientKernel.create(p, "gradientNLL");
 }
@@ -0,0 +1,327 @@
+#include "RNA/Maths/activations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNA_ACTIVATIONS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace rna
+{
+
+static_assert(std::is_same<Tensor::value_type, float>::value, "activation kernels are written for single precision");
+
+using real = Tensor::value_type;
+
+namespace
+{
+
+#ifdef RNA_ACTIVATIONS_AVX2
+bool hasAVX2()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }();
+
+    return supported;
+}
+
+// exp(x) = 2^n * exp(r) with |r| <= ln(2)/2, exp(r) being a degree 7 polynomial (Cephes coefficients)
+// Relative error is below 2 ulp on the clamped range
+__attribute__((target("avx2,fma")))
+__m256 exp256(__m256 _x)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    _x = _mm256_min_ps(_mm256_max_ps(_x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(_x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), _x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, one));
+
+    __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(exponent));
+}
+
+// exp(x) - 1 without the cancellation near 0: Taylor polynomial of degree 8 for |x| < 0.5, exp256 above
+__attribute__((target("avx2,fma")))
+__m256 expm1256(__m256 _x)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 p = _mm256_set1_ps(1.0f / 40320.0f);
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(1.0f / 5040.0f));
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(1.0f / 720.0f));
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(1.0f / 120.0f));
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(1.0f / 24.0f));
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(1.0f / 6.0f));
+    p = _mm256_fmadd_ps(p, _x, _mm256_set1_ps(0.5f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(_x, _x), _x);
+
+    __m256 small = _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), _x), _mm256_set1_ps(0.5f), _CMP_LT_OQ);
+
+    return _mm256_blendv_ps(_mm256_sub_ps(exp256(_x), one), p, small);
+}
+#endif // RNA_ACTIVATIONS_AVX2
+
+
+/// Scalar versions, used without AVX2 and on the tail of each array
+real tanhScalar(real _x)
+{
+    return std::tanh(_x);
+}
+
+real sigmoidScalar(real _x)
+{
+    return 1.0f / (1.0f + std::exp(-_x));
+}
+
+real eluScalar(real _x, real _alpha)
+{
+    return _x < 0.0f? _alpha * std::expm1(_x): _x;
+}
+
+}
+
+
+/// Tanh
+#ifdef RNA_ACTIVATIONS_AVX2
+__attribute__((target("avx2,fma")))
+static size_t tanhForwardAVX2(real* _output, const real* _input, size_t _n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(_input + i);
+        __m256 sign = _mm256_and_ps(x, signMask);
+        __m256 absX = _mm256_andnot_ps(signMask, x);
+
+        // tanh(|x|) = 1 - 2 / (exp(2|x|) + 1), then restore the sign
+        __m256 e = exp256(_mm256_mul_ps(two, absX));
+        __m256 t = _mm256_or_ps(_mm256_sub_ps(one, _mm256_div_ps(two, _mm256_add_ps(e, one))), sign);
+
+        // That difference cancels below 0.625: odd polynomial instead (Cephes tanhf), relative error around 1 ulp
+        __m256 z = _mm256_mul_ps(x, x);
+        __m256 p = _mm256_set1_ps(-5.70498872745e-3f);
+        p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.06390887954e-2f));
+        p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-5.37397155531e-2f));
+        p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.33314422036e-1f));
+        p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-3.33332819422e-1f));
+        p = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+
+        __m256 small = _mm256_cmp_ps(absX, _mm256_set1_ps(0.625f), _CMP_LT_OQ);
+
+        _mm256_storeu_ps(_output + i, _mm256_blendv_ps(t, p, small));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t tanhBackwardAVX2(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 y = _mm256_loadu_ps(_output + i);
+        _mm256_storeu_ps(_inputGrad + i, _mm256_mul_ps(_mm256_fnmadd_ps(y, y, one), _mm256_loadu_ps(_outputGrad + i)));
+    }
+
+    return i;
+}
+#endif // RNA_ACTIVATIONS_AVX2
+
+void tanhForward(real* _output, const real* _input, size_t _n)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = tanhForwardAVX2(_output, _input, _n);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _output[i] = tanhScalar(_input[i]);
+}
+
+void tanhBackward(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = tanhBackwardAVX2(_inputGrad, _output, _outputGrad, _n);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _inputGrad[i] = (1.0f - _output[i]*_output[i]) * _outputGrad[i];
+}
+
+
+/// Sigmoid
+#ifdef RNA_ACTIVATIONS_AVX2
+__attribute__((target("avx2,fma")))
+static size_t sigmoidForwardAVX2(real* _output, const real* _input, size_t _n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(_input + i);
+        __m256 e = exp256(_mm256_xor_ps(x, signMask));
+
+        _mm256_storeu_ps(_output + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t sigmoidBackwardAVX2(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 y = _mm256_loadu_ps(_output + i);
+        __m256 dy = _mm256_mul_ps(y, _mm256_sub_ps(one, y));
+
+        _mm256_storeu_ps(_inputGrad + i, _mm256_mul_ps(dy, _mm256_loadu_ps(_outputGrad + i)));
+    }
+
+    return i;
+}
+#endif // RNA_ACTIVATIONS_AVX2
+
+void sigmoidForward(real* _output, const real* _input, size_t _n)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = sigmoidForwardAVX2(_output, _input, _n);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _output[i] = sigmoidScalar(_input[i]);
+}
+
+void sigmoidBackward(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = sigmoidBackwardAVX2(_inputGrad, _output, _outputGrad, _n);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _inputGrad[i] = _output[i] * (1.0f - _output[i]) * _outputGrad[i];
+}
+
+
+/// ReLU
+// Plain loops: the compiler vectorizes them for the baseline instruction set
+void reluForward(real* _output, const real* _input, size_t _n)
+{
+    for (size_t i(0) ; i < _n ; i++)
+        _output[i] = std::max(_input[i], 0.0f);
+}
+
+void reluBackward(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n)
+{
+    for (size_t i(0) ; i < _n ; i++)
+        _inputGrad[i] = _output[i] > 0.0f? _outputGrad[i]: 0.0f;
+}
+
+
+/// ELU
+#ifdef RNA_ACTIVATIONS_AVX2
+__attribute__((target("avx2,fma")))
+static size_t eluForwardAVX2(real* _output, const real* _input, size_t _n, real _alpha)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 alpha = _mm256_set1_ps(_alpha);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(_input + i);
+        __m256 negative = _mm256_mul_ps(alpha, expm1256(_mm256_min_ps(x, zero)));
+
+        _mm256_storeu_ps(_output + i, _mm256_blendv_ps(x, negative, _mm256_cmp_ps(x, zero, _CMP_LT_OQ)));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t eluBackwardAVX2(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n, real _alpha)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    const __m256 alpha = _mm256_set1_ps(_alpha);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        // alpha * exp(x) = y + alpha on the negative side
+        __m256 y = _mm256_loadu_ps(_output + i);
+        __m256 dy = _mm256_blendv_ps(one, _mm256_add_ps(y, alpha), _mm256_cmp_ps(y, zero, _CMP_LT_OQ));
+
+        _mm256_storeu_ps(_inputGrad + i, _mm256_mul_ps(dy, _mm256_loadu_ps(_outputGrad + i)));
+    }
+
+    return i;
+}
+#endif // RNA_ACTIVATIONS_AVX2
+
+void eluForward(real* _output, const real* _input, size_t _n, real _alpha)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = eluForwardAVX2(_output, _input, _n, _alpha);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _output[i] = eluScalar(_input[i], _alpha);
+}
+
+void eluBackward(real* _inputGrad, const real* _output, const real* _outputGrad, size_t _n, real _alpha)
+{
+    size_t i(0);
+
+    #ifdef RNA_ACTIVATIONS_AVX2
+    if (hasAVX2())
+        i = eluBackwardAVX2(_inputGrad, _output, _outputGrad, _n, _alpha);
+    #endif // RNA_ACTIVATIONS_AVX2
+
+    for ( ; i < _n ; i++)
+        _inputGrad[i] = (_output[i] < 0.0f? _output[i] + _alpha: 1.0f) * _outputGrad[i];
+}
+
+}
@@ -0,0 +1,75 @@
+#include "RNA/Maths/bfloat16.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNA_BFLOAT16_AVX2
+#include <immintrin.h>
+#endif
+
+namespace rna
+{
+
+namespace
+{
+
+#ifdef RNA_BFLOAT16_AVX2
+bool hasAVX2()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }();
+
+    return supported;
+}
+
+// Same rounding as the scalar version, 8 values at a time
+__attribute__((target("avx2")))
+inline __m256i roundAVX2(const Tensor::value_type* _src)
+{
+    const __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_src));
+
+    const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff))), 16);
+
+    const __m256i magnitude = _mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff));
+    const __m256i nan = _mm256_cmpgt_epi32(magnitude, _mm256_set1_epi32(0x7f800000));
+    const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x0040));
+
+    return _mm256_blendv_epi8(rounded, quiet, nan);
+}
+
+/// Returns the number of values converted, the rest is left to the scalar loop
+__attribute__((target("avx2")))
+size_t toBFloat16AVX2(bfloat16* _dst, const Tensor::value_type* _src, size_t _n)
+{
+    size_t i(0);
+    for ( ; i + 16 <= _n ; i += 16)
+    {
+        // Values fit in 16 bits, so the saturating pack only narrows them; it works per 128 bits lane
+        __m256i packed = _mm256_packus_epi32(roundAVX2(_src + i), roundAVX2(_src + i + 8));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_dst + i), packed);
+    }
+
+    return i;
+}
+#endif // RNA_BFLOAT16_AVX2
+
+}
+
+void toBFloat16(bfloat16* _dst, const Tensor::value_type* _src, size_t _n)
+{
+    size_t i(0);
+
+    #ifdef RNA_BFLOAT16_AVX2
+    if (hasAVX2())
+        i = toBFloat16AVX2(_dst, _src, _n);
+    #endif // RNA_BFLOAT16_AVX2
+
+    for ( ; i < _n ; i++)
+        _dst[i] = toBFloat16(_src[i]);
+}
+
+}
@@ -0,0 +1,150 @@
+#include "RNA/Maths/fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace rna
+{
+
+namespace
+{
+
+// Complex products are written out: std::complex's operator* handles NaN/infinity cases through a library call
+inline void multiply(Tensor::value_type _ar, Tensor::value_type _ai, Tensor::value_type _br, Tensor::value_type _bi, Tensor::value_type& _r, Tensor::value_type& _i)
+{
+    _r = _ar*_br - _ai*_bi;
+    _i = _ar*_bi + _ai*_br;
+}
+
+/// Twiddles are computed once per size and direction, per thread so that the pool workers never lock
+const std::vector<Complex>& twiddles(size_t _n, bool _inverse)
+{
+    thread_local std::map<std::pair<size_t, bool>, std::vector<Complex>> cache;
+
+    std::vector<Complex>& twiddles = cache[std::make_pair(_n, _inverse)];
+    if (twiddles.size() == _n / 2)
+        return twiddles;
+
+    const double pi = 3.14159265358979323846;
+    double sign = _inverse? 1.0: -1.0;
+
+    twiddles.resize(_n / 2);
+    for (size_t k(0) ; k < _n / 2 ; k++)
+        twiddles[k] = Complex(cos(2.0*pi*k / _n), sign * sin(2.0*pi*k / _n));
+
+    return twiddles;
+}
+
+// Iterative Cooley-Tukey on a contiguous sequence
+void fft(Complex* _data, size_t _n, const std::vector<Complex>& _twiddles)
+{
+    for (size_t i(1), j(0) ; i < _n ; i++)
+    {
+        size_t bit = _n >> 1;
+        for ( ; j & bit ; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap(_data[i], _data[j]);
+    }
+
+    Tensor::value_type* data = reinterpret_cast<Tensor::value_type*>(_data);
+
+    for (size_t length(2) ; length <= _n ; length <<= 1)
+    {
+        size_t half = length / 2, step = _n / length;
+
+        for (size_t start(0) ; start < _n ; start += length)
+        {
+            for (size_t k(0) ; k < half ; k++)
+            {
+                Tensor::value_type* u = data + 2*(start + k);
+                Tensor::value_type* v = data + 2*(start + k + half);
+
+                Tensor::value_type tr, ti;
+                multiply(_twiddles[k*step].real(), _twiddles[k*step].imag(), v[0], v[1], tr, ti);
+
+                v[0] = u[0] - tr; v[1] = u[1] - ti;
+                u[0] = u[0] + tr; u[1] = u[1] + ti;
+            }
+        }
+    }
+}
+
+}
+
+size_t nextPowerOfTwo(size_t _n)
+{
+    size_t p = 1;
+    while (p < _n)
+        p <<= 1;
+
+    return p;
+}
+
+void fft2d(Complex* _data, size_t _rows, size_t _columns, bool _inverse)
+{
+    const std::vector<Complex>& rowTwiddles = twiddles(_columns, _inverse);
+    const std::vector<Complex>& columnTwiddles = twiddles(_rows, _inverse);
+
+    thread_local std::vector<Complex> column;
+    column.resize(_rows);
+
+    for (size_t i(0) ; i < _rows ; i++)
+        fft(_data + i*_columns, _columns, rowTwiddles);
+
+    for (size_t j(0) ; j < _columns ; j++)
+    {
+        for (size_t i(0) ; i < _rows ; i++)
+            column[i] = _data[i*_columns + j];
+
+        fft(column.data(), _rows, columnTwiddles);
+
+        for (size_t i(0) ; i < _rows ; i++)
+            _data[i*_columns + j] = column[i];
+    }
+
+    if (_inverse)
+    {
+        Tensor::value_type scale = 1.0f / (_rows * _columns);
+        Tensor::value_type* data = reinterpret_cast<Tensor::value_type*>(_data);
+
+        for (size_t i(0) ; i < 2*_rows*_columns ; i++)
+            data[i] *= scale;
+    }
+}
+
+void realToSpectrum(Complex* _spectrum, const Tensor::value_type* _plane, size_t _width, size_t _height, size_t _rows, size_t _columns)
+{
+    std::fill(_spectrum, _spectrum + _rows*_columns, Complex(0.0f, 0.0f));
+
+    for (size_t x(0) ; x < _width ; x++)
+        for (size_t y(0) ; y < _height ; y++)
+            _spectrum[x*_columns + y] = Complex(_plane[x*_height + y], 0.0f);
+
+    fft2d(_spectrum, _rows, _columns, false);
+}
+
+void multiplyAccumulate(Complex* _result, const Complex* _a, const Complex* _b, size_t _n, bool _conjugateA)
+{
+    Tensor::value_type* result = reinterpret_cast<Tensor::value_type*>(_result);
+    const Tensor::value_type* a = reinterpret_cast<const Tensor::value_type*>(_a);
+    const Tensor::value_type* b = reinterpret_cast<const Tensor::value_type*>(_b);
+
+    Tensor::value_type sign = _conjugateA? -1.0f: 1.0f;
+
+    for (size_t i(0) ; i < _n ; i++)
+    {
+        Tensor::value_type r, im;
+        multiply(a[2*i], sign * a[2*i+1], b[2*i], b[2*i+1], r, im);
+
+        result[2*i] += r;
+        result[2*i+1] += im;
+    }
+}
+
+}
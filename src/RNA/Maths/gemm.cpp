@@ -0,0 +1,553 @@
+#include "RNA/Maths/gemm.h"
+#include "RNA/ThreadPool.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNA_GEMM_AVX2
+#include <immintrin.h>
+#endif
+
+namespace rna
+{
+
+static_assert(std::is_same<Tensor::value_type, float>::value, "gemm kernels are written for single precision");
+
+using real = Tensor::value_type;
+
+namespace
+{
+
+// Register block computed by one micro-kernel call
+const size_t MR = 6;
+const size_t NR = 16;
+
+// Cache blocks: a MC x KC panel of A stays in L2 while KC x NR slivers of B stream through L1
+const size_t MC = 96;   // multiple of MR
+const size_t KC = 256;
+const size_t NC = 2048; // multiple of NR
+
+// Below this number of multiply-adds, synchronizing threads costs more than it saves
+const size_t PARALLEL_MIN_MACS = 1 << 16;
+
+// Tasks per thread: more tasks than threads balance the load when some cores are busy
+const size_t TASKS_PER_THREAD = 4;
+
+size_t roundUp(size_t _value, size_t _multiple)
+{
+    return (_value + _multiple - 1) / _multiple * _multiple;
+}
+
+size_t divideUp(size_t _value, size_t _divisor)
+{
+    return (_value + _divisor - 1) / _divisor;
+}
+
+// Runs the tasks on the shared pool when there is enough work, inline otherwise
+void forEach(bool _parallel, size_t _tasks, const std::function<void(size_t)>& _task)
+{
+    if (_parallel)
+        ThreadPool::global().run(_tasks, _task);
+
+    else
+        for (size_t i(0) ; i < _tasks ; i++)
+            _task(i);
+}
+
+#ifdef RNA_GEMM_AVX2
+bool hasAVX2()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }();
+
+    return supported;
+}
+#endif // RNA_GEMM_AVX2
+
+// Operands stored in bfloat16 are converted to single precision as they are read
+inline real widen(real _value)
+{
+    return _value;
+}
+
+inline real widen(bfloat16 _value)
+{
+    return toFloat(_value);
+}
+
+void widen(const real* _src, size_t _n, real* _dst)
+{
+    std::copy(_src, _src + _n, _dst);
+}
+
+void widen(const bfloat16* _src, size_t _n, real* _dst)
+{
+    for (size_t i(0) ; i < _n ; i++)
+        _dst[i] = toFloat(_src[i]);
+}
+
+
+/// Packing
+// op(A) block (mc x kc) is stored as panels of MR rows, each panel being kc columns of MR values
+void packA(bool _trans, const real* _A, size_t _lda, size_t _mc, size_t _kc, real _alpha, real* _dst)
+{
+    for (size_t i(0) ; i < _mc ; i += MR)
+    {
+        size_t mr = std::min(MR, _mc - i);
+
+        for (size_t p(0) ; p < _kc ; p++)
+        {
+            for (size_t r(0) ; r < mr ; r++)
+                _dst[r] = _alpha * (_trans? _A[p*_lda + i+r]: _A[(i+r)*_lda + p]);
+
+            for (size_t r(mr) ; r < MR ; r++)
+                _dst[r] = 0.0f;
+
+            _dst += MR;
+        }
+    }
+}
+
+// op(B) block (kc x nc) is stored as panels of NR columns, each panel being kc rows of NR values
+template<typename T>
+void packB(bool _trans, const T* _B, size_t _ldb, size_t _kc, size_t _nc, real* _dst)
+{
+    for (size_t j(0) ; j < _nc ; j += NR)
+    {
+        size_t nr = std::min(NR, _nc - j);
+
+        for (size_t p(0) ; p < _kc ; p++)
+        {
+            if (!_trans && nr == NR)
+                widen(_B + p*_ldb + j, NR, _dst);
+
+            else
+            {
+                for (size_t c(0) ; c < nr ; c++)
+                    _dst[c] = widen(_trans? _B[(j+c)*_ldb + p]: _B[p*_ldb + j+c]);
+
+                for (size_t c(nr) ; c < NR ; c++)
+                    _dst[c] = 0.0f;
+            }
+
+            _dst += NR;
+        }
+    }
+}
+
+
+/// Micro-kernels
+// Writes (or adds, when accumulating) the mr x nr top left corner of a MR x NR tile into C
+void storeTile(const real* _tile, real* _C, size_t _ldc, bool _accumulate, size_t _mr, size_t _nr)
+{
+    for (size_t i(0) ; i < _mr ; i++)
+    {
+        for (size_t j(0) ; j < _nr ; j++)
+        {
+            if (_accumulate)
+                _C[i*_ldc + j] += _tile[i*NR + j];
+            else
+                _C[i*_ldc + j] = _tile[i*NR + j];
+        }
+    }
+}
+
+void kernelGeneric(size_t _kc, const real* _a, const real* _b, real* _C, size_t _ldc, bool _accumulate, size_t _mr, size_t _nr)
+{
+    real tile[MR*NR] = {};
+
+    for (size_t p(0) ; p < _kc ; p++)
+    {
+        for (size_t i(0) ; i < MR ; i++)
+        {
+            real a = _a[i];
+
+            for (size_t j(0) ; j < NR ; j++)
+                tile[i*NR + j] += a * _b[j];
+        }
+
+        _a += MR;
+        _b += NR;
+    }
+
+    storeTile(tile, _C, _ldc, _accumulate, _mr, _nr);
+}
+
+#ifdef RNA_GEMM_AVX2
+__attribute__((target("avx2,fma")))
+void kernelAVX2(size_t _kc, const real* _a, const real* _b, real* _C, size_t _ldc, bool _accumulate, size_t _mr, size_t _nr)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (size_t p(0) ; p < _kc ; p++)
+    {
+        __m256 b0 = _mm256_loadu_ps(_b);
+        __m256 b1 = _mm256_loadu_ps(_b + 8);
+        __m256 a;
+
+        a = _mm256_broadcast_ss(_a + 0); c00 = _mm256_fmadd_ps(a, b0, c00); c01 = _mm256_fmadd_ps(a, b1, c01);
+        a = _mm256_broadcast_ss(_a + 1); c10 = _mm256_fmadd_ps(a, b0, c10); c11 = _mm256_fmadd_ps(a, b1, c11);
+        a = _mm256_broadcast_ss(_a + 2); c20 = _mm256_fmadd_ps(a, b0, c20); c21 = _mm256_fmadd_ps(a, b1, c21);
+        a = _mm256_broadcast_ss(_a + 3); c30 = _mm256_fmadd_ps(a, b0, c30); c31 = _mm256_fmadd_ps(a, b1, c31);
+        a = _mm256_broadcast_ss(_a + 4); c40 = _mm256_fmadd_ps(a, b0, c40); c41 = _mm256_fmadd_ps(a, b1, c41);
+        a = _mm256_broadcast_ss(_a + 5); c50 = _mm256_fmadd_ps(a, b0, c50); c51 = _mm256_fmadd_ps(a, b1, c51);
+
+        _a += MR;
+        _b += NR;
+    }
+
+    __m256 rows[MR][2] = { {c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51} };
+
+    if (_mr == MR && _nr == NR)
+    {
+        for (size_t i(0) ; i < MR ; i++)
+        {
+            real* c = _C + i*_ldc;
+
+            if (_accumulate)
+            {
+                rows[i][0] = _mm256_add_ps(rows[i][0], _mm256_loadu_ps(c));
+                rows[i][1] = _mm256_add_ps(rows[i][1], _mm256_loadu_ps(c + 8));
+            }
+
+            _mm256_storeu_ps(c, rows[i][0]);
+            _mm256_storeu_ps(c + 8, rows[i][1]);
+        }
+    }
+    else
+    {
+        real tile[MR*NR];
+
+        for (size_t i(0) ; i < MR ; i++)
+        {
+            _mm256_storeu_ps(tile + i*NR, rows[i][0]);
+            _mm256_storeu_ps(tile + i*NR + 8, rows[i][1]);
+        }
+
+        storeTile(tile, _C, _ldc, _accumulate, _mr, _nr);
+    }
+}
+#endif // RNA_GEMM_AVX2
+
+
+/// Level 1 helpers (used for matrix-vector products)
+template<typename T>
+real dot(size_t _n, const T* _x, const real* _y, size_t _incy)
+{
+    real sum = 0.0f;
+    for (size_t i(0) ; i < _n ; i++)
+        sum += widen(_x[i]) * _y[i*_incy];
+
+    return sum;
+}
+
+template<typename T>
+void axpy(size_t _n, real _alpha, const T* _x, real* _y)
+{
+    for (size_t i(0) ; i < _n ; i++)
+        _y[i] += _alpha * widen(_x[i]);
+}
+
+#ifdef RNA_GEMM_AVX2
+__attribute__((target("avx2,fma")))
+inline __m256 load8(const real* _x)
+{
+    return _mm256_loadu_ps(_x);
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256 load8(const bfloat16* _x)
+{
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_x));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(half), 16));
+}
+
+template<typename T>
+__attribute__((target("avx2,fma")))
+real dotAVX2(size_t _n, const T* _x, const real* _y)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+
+    size_t i(0);
+    for ( ; i + 16 <= _n ; i += 16)
+    {
+        s0 = _mm256_fmadd_ps(load8(_x + i),     _mm256_loadu_ps(_y + i),     s0);
+        s1 = _mm256_fmadd_ps(load8(_x + i + 8), _mm256_loadu_ps(_y + i + 8), s1);
+    }
+
+    real partial[8];
+    _mm256_storeu_ps(partial, _mm256_add_ps(s0, s1));
+
+    real sum = 0.0f;
+    for (size_t j(0) ; j < 8 ; j++)
+        sum += partial[j];
+
+    for ( ; i < _n ; i++)
+        sum += widen(_x[i]) * _y[i];
+
+    return sum;
+}
+
+template<typename T>
+__attribute__((target("avx2,fma")))
+void axpyAVX2(size_t _n, real _alpha, const T* _x, real* _y)
+{
+    __m256 alpha = _mm256_set1_ps(_alpha);
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+        _mm256_storeu_ps(_y + i, _mm256_fmadd_ps(alpha, load8(_x + i), _mm256_loadu_ps(_y + i)));
+
+    for ( ; i < _n ; i++)
+        _y[i] += _alpha * widen(_x[i]);
+}
+#endif // RNA_GEMM_AVX2
+
+// y = alpha * op(M) * x + beta * y, with op(M) being m x k
+template<typename T>
+void gemvSerial(bool _trans, size_t _m, size_t _k, real _alpha, const T* _M, size_t _ldm, const real* _x, size_t _incx, real _beta, real* _y, size_t _incy)
+{
+    #ifdef RNA_GEMM_AVX2
+    bool simd = hasAVX2();
+    #endif // RNA_GEMM_AVX2
+
+    if (!_trans)
+    {
+        // Rows of M are contiguous: one dot product per output
+        for (size_t i(0) ; i < _m ; i++)
+        {
+            #ifdef RNA_GEMM_AVX2
+            real value = (simd && _incx == 1)? dotAVX2(_k, _M + i*_ldm, _x): dot(_k, _M + i*_ldm, _x, _incx);
+            #else
+            real value = dot(_k, _M + i*_ldm, _x, _incx);
+            #endif // RNA_GEMM_AVX2
+
+            _y[i*_incy] = _alpha * value + (_beta == 0.0f? 0.0f: _beta * _y[i*_incy]);
+        }
+    }
+    else
+    {
+        // Columns of op(M) are contiguous: accumulate scaled rows of M
+        std::vector<real> y(_m, 0.0f);
+
+        for (size_t p(0) ; p < _k ; p++)
+        {
+            #ifdef RNA_GEMM_AVX2
+            if (simd)
+                axpyAVX2(_m, _alpha * _x[p*_incx], _M + p*_ldm, y.data());
+            else
+            #endif // RNA_GEMM_AVX2
+                axpy(_m, _alpha * _x[p*_incx], _M + p*_ldm, y.data());
+        }
+
+        for (size_t i(0) ; i < _m ; i++)
+            _y[i*_incy] = y[i] + (_beta == 0.0f? 0.0f: _beta * _y[i*_incy]);
+    }
+}
+
+// Outputs are split in ranges, each computed by one task
+template<typename T>
+void gemv(bool _trans, size_t _m, size_t _k, real _alpha, const T* _M, size_t _ldm, const real* _x, size_t _incx, real _beta, real* _y, size_t _incy)
+{
+    const size_t minRows = 64;
+
+    size_t tasks = std::min(divideUp(_m, minRows), ThreadPool::global().size() * TASKS_PER_THREAD);
+
+    forEach(_m*_k >= PARALLEL_MIN_MACS, tasks, [&](size_t _task)
+    {
+        size_t begin = _m * _task / tasks, end = _m * (_task+1) / tasks;
+        const T* M = _trans? _M + begin: _M + begin*_ldm;
+
+        gemvSerial(_trans, end - begin, _k, _alpha, M, _ldm, _x, _incx, _beta, _y + begin*_incy, _incy);
+    });
+}
+
+// op(B) is a vector: read in place in single precision
+void gemvB(bool _transA, size_t _m, size_t _k, real _alpha, const real* _A, size_t _lda, const real* _x, size_t _incx, real _beta, real* _C, size_t _ldc)
+{
+    gemv(_transA, _m, _k, _alpha, _A, _lda, _x, _incx, _beta, _C, _ldc);
+}
+
+// bfloat16 is widened once
+void gemvB(bool _transA, size_t _m, size_t _k, real _alpha, const real* _A, size_t _lda, const bfloat16* _x, size_t _incx, real _beta, real* _C, size_t _ldc)
+{
+    std::vector<real> x(_k);
+    for (size_t p(0) ; p < _k ; p++)
+        x[p] = widen(_x[p*_incx]);
+
+    gemv(_transA, _m, _k, _alpha, _A, _lda, x.data(), 1, _beta, _C, _ldc);
+}
+
+template<typename T>
+void gemmImpl(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k,
+              real _alpha, const real* _A, size_t _lda,
+                           const T* _B, size_t _ldb,
+              real _beta,        real* _C, size_t _ldc,
+              const GemmEpilogue& _epilogue)
+{
+    if (_m == 0 || _n == 0)
+        return;
+
+    // Reduce to beta = 0 (overwrite) or beta = 1 (accumulate)
+    if (_beta != 0.0f && _beta != 1.0f)
+    {
+        for (size_t i(0) ; i < _m ; i++)
+            for (size_t j(0) ; j < _n ; j++)
+                _C[i*_ldc + j] *= _beta;
+
+        _beta = 1.0f;
+    }
+
+    if (_k == 0 || _alpha == 0.0f)
+    {
+        if (_beta == 0.0f)
+            for (size_t i(0) ; i < _m ; i++)
+                std::fill(_C + i*_ldc, _C + i*_ldc + _n, 0.0f);
+
+        if (_epilogue)
+            _epilogue(_C, _ldc, 0, 0, _m, _n);
+
+        return;
+    }
+
+    // Matrix-vector products are memory bound: packing would only add traffic
+    if (_n == 1 || _m == 1)
+    {
+        if (_n == 1)
+            gemvB(_transA, _m, _k, _alpha, _A, _lda, _B, _transB? 1: _ldb, _beta, _C, _ldc);
+        else
+            gemv(!_transB, _n, _k, _alpha, _B, _ldb, _A, _transA? _lda: 1, _beta, _C, 1);
+
+        if (_epilogue)
+            _epilogue(_C, _ldc, 0, 0, _m, _n);
+
+        return;
+    }
+
+
+    auto kernel = kernelGeneric;
+
+    #ifdef RNA_GEMM_AVX2
+    if (hasAVX2())
+        kernel = kernelAVX2;
+    #endif // RNA_GEMM_AVX2
+
+    bool parallel = _m*_n*_k >= PARALLEL_MIN_MACS;
+    size_t threads = parallel? ThreadPool::global().size(): 1;
+
+    // The whole op(A) panel is packed, so that tasks can share it
+    std::vector<real> packedA(roundUp(_m, MR) * std::min(_k, KC));
+    std::vector<real> packedB(roundUp(std::min(_n, NC), NR) * std::min(_k, KC));
+
+    size_t rowBlocks = divideUp(_m, MC);
+
+    for (size_t jc(0) ; jc < _n ; jc += NC)
+    {
+        size_t nc = std::min(NC, _n - jc);
+        size_t slivers = divideUp(nc, NR);
+
+        // Columns of C are split in chunks of slivers so that there is work for every thread, even when m is small
+        size_t columnChunks = std::min(slivers, divideUp(threads * TASKS_PER_THREAD, rowBlocks));
+        size_t packChunks = std::min(slivers, threads);
+
+        for (size_t pc(0) ; pc < _k ; pc += KC)
+        {
+            size_t kc = std::min(KC, _k - pc);
+            bool accumulate = (pc != 0) || (_beta != 0.0f);
+            bool last = (pc + kc == _k);
+
+            forEach(parallel, packChunks, [&](size_t _chunk)
+            {
+                size_t begin = slivers * _chunk / packChunks * NR, end = std::min(nc, slivers * (_chunk+1) / packChunks * NR);
+                const T* B = _transB? _B + (jc+begin)*_ldb + pc: _B + pc*_ldb + jc+begin;
+
+                packB(_transB, B, _ldb, kc, end - begin, packedB.data() + begin*kc);
+            });
+
+            forEach(parallel, rowBlocks, [&](size_t _block)
+            {
+                size_t ic = _block * MC, mc = std::min(MC, _m - ic);
+
+                packA(_transA, _transA? _A + pc*_lda + ic: _A + ic*_lda + pc, _lda, mc, kc, _alpha, packedA.data() + ic*kc);
+            });
+
+            forEach(parallel, rowBlocks * columnChunks, [&](size_t _task)
+            {
+                size_t ic = _task / columnChunks * MC, mc = std::min(MC, _m - ic);
+                size_t chunk = _task % columnChunks;
+
+                size_t begin = slivers * chunk / columnChunks * NR, end = std::min(nc, slivers * (chunk+1) / columnChunks * NR);
+
+                for (size_t jr(begin) ; jr < end ; jr += NR)
+                {
+                    size_t nr = std::min(NR, nc - jr);
+
+                    for (size_t ir(0) ; ir < mc ; ir += MR)
+                    {
+                        size_t mr = std::min(MR, mc - ir);
+
+                        real* tile = _C + (ic+ir)*_ldc + jc+jr;
+                        kernel(kc, packedA.data() + (ic+ir)*kc, packedB.data() + jr*kc, tile, _ldc, accumulate, mr, nr);
+
+                        if (last && _epilogue)
+                            _epilogue(tile, _ldc, ic+ir, jc+jr, mr, nr);
+                    }
+                }
+            });
+        }
+    }
+}
+
+}
+
+void gemm(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k,
+          real _alpha, const real* _A, size_t _lda,
+                       const real* _B, size_t _ldb,
+          real _beta,        real* _C, size_t _ldc,
+          const GemmEpilogue& _epilogue)
+{
+    gemmImpl(_transA, _transB, _m, _n, _k, _alpha, _A, _lda, _B, _ldb, _beta, _C, _ldc, _epilogue);
+}
+
+void gemm(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k,
+          real _alpha, const real* _A, size_t _lda,
+                       const bfloat16* _B, size_t _ldb,
+          real _beta,        real* _C, size_t _ldc,
+          const GemmEpilogue& _epilogue)
+{
+    gemmImpl(_transA, _transB, _m, _n, _k, _alpha, _A, _lda, _B, _ldb, _beta, _C, _ldc, _epilogue);
+}
+
+void addRows(real* _sums, const real* _A, size_t _m, size_t _n)
+{
+    #ifdef RNA_GEMM_AVX2
+    if (hasAVX2())
+    {
+        for (size_t i(0) ; i < _m ; i++)
+            axpyAVX2(_n, 1.0f, _A + i*_n, _sums);
+
+        return;
+    }
+    #endif // RNA_GEMM_AVX2
+
+    for (size_t i(0) ; i < _m ; i++)
+        axpy(_n, 1.0f, _A + i*_n, _sums);
+}
+
+void broadcastRows(real* _A, const real* _row, size_t _m, size_t _n)
+{
+    for (size_t i(0) ; i < _m ; i++)
+        std::copy(_row, _row + _n, _A + i*_n);
+}
+
+}
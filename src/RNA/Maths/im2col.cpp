@@ -0,0 +1,97 @@
+#include "RNA/Maths/im2col.h"
+#include "RNA/ThreadPool.h"
+
+#include <algorithm>
+
+namespace rna
+{
+
+namespace
+{
+
+// Below this number of copied values per call, channels are processed by the calling thread
+const size_t PARALLEL_MIN_VALUES = 1 << 15;
+
+// Channels are independent: each task processes a range of them
+size_t channelTasks(size_t _channels, size_t _valuesPerChannel)
+{
+    if (_channels * _valuesPerChannel < PARALLEL_MIN_VALUES)
+        return 1;
+
+    return std::min(_channels, ThreadPool::global().size());
+}
+
+}
+
+void im2col(Tensor::value_type* _columns, const Tensor::value_type* _image,
+            size_t _channels, size_t _width, size_t _height, size_t _kernelWidth, size_t _kernelHeight)
+{
+    size_t outputWidth = _width - _kernelWidth + 1;
+    size_t outputHeight = _height - _kernelHeight + 1;
+
+    size_t channelSize = _kernelWidth*_kernelHeight * outputWidth*outputHeight;
+    size_t tasks = channelTasks(_channels, channelSize);
+
+    ThreadPool::global().run(tasks, [&](size_t _task)
+    {
+        size_t begin = _channels * _task / tasks, end = _channels * (_task+1) / tasks;
+        Tensor::value_type* columns = _columns + begin*channelSize;
+
+        for (size_t c(begin) ; c < end ; c++)
+        {
+            for (size_t u(0) ; u < _kernelWidth ; u++)
+            {
+                for (size_t v(0) ; v < _kernelHeight ; v++)
+                {
+                    const Tensor::value_type* source = _image + c*_width*_height + (_kernelWidth-1-u)*_height + (_kernelHeight-1-v);
+
+                    for (size_t x(0) ; x < outputWidth ; x++)
+                    {
+                        std::copy(source, source + outputHeight, columns);
+
+                        source += _height;
+                        columns += outputHeight;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void col2im(Tensor::value_type* _image, const Tensor::value_type* _columns,
+            size_t _channels, size_t _width, size_t _height, size_t _kernelWidth, size_t _kernelHeight)
+{
+    size_t outputWidth = _width - _kernelWidth + 1;
+    size_t outputHeight = _height - _kernelHeight + 1;
+
+    size_t channelSize = _kernelWidth*_kernelHeight * outputWidth*outputHeight;
+    size_t tasks = channelTasks(_channels, channelSize);
+
+    ThreadPool::global().run(tasks, [&](size_t _task)
+    {
+        size_t begin = _channels * _task / tasks, end = _channels * (_task+1) / tasks;
+        const Tensor::value_type* columns = _columns + begin*channelSize;
+
+        for (size_t c(begin) ; c < end ; c++)
+        {
+            for (size_t u(0) ; u < _kernelWidth ; u++)
+            {
+                for (size_t v(0) ; v < _kernelHeight ; v++)
+                {
+                    Tensor::value_type* destination = _image + c*_width*_height + (_kernelWidth-1-u)*_height + (_kernelHeight-1-v);
+
+                    for (size_t x(0) ; x < outputWidth ; x++)
+                    {
+                        for (size_t y(0) ; y < outputHeight ; y++)
+                            destination[y] += columns[y];
+
+                        destination += _height;
+                        columns += outputHeight;
+                    }
+                }
+            }
+        }
+    });
+}
+
+}
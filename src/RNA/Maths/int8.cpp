@@ -0,0 +1,318 @@
+#include "RNA/Maths/int8.h"
+#include "RNA/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNA_INT8_AVX2
+#include <immintrin.h>
+
+// AVX-VNNI intrinsics appeared in GCC 11 and Clang 12
+#if (defined(__clang__) && __clang_major__ >= 12) || (!defined(__clang__) && __GNUC__ >= 11)
+#define RNA_INT8_VNNI
+#endif
+#endif
+
+namespace rna
+{
+
+using real = Tensor::value_type;
+
+namespace
+{
+
+// Blocks of C computed by one task, then rescaled while they are in cache
+const size_t ROW_BLOCK = 16;
+const size_t COLUMN_BLOCK = 64;
+
+// Register block: RR rows of A against RC rows of B (the kernels are written for 2 x 4)
+const size_t RR = 2;
+const size_t RC = 4;
+
+// Below this number of multiply-adds, synchronizing threads costs more than it saves
+const size_t PARALLEL_MIN_MACS = 1 << 16;
+
+const int32_t ZERO_POINT = 128;
+
+int quantizeValue(real _value, real _inverseScale)
+{
+    real q = std::min(std::max(_value * _inverseScale, -127.0f), 127.0f);
+
+    return int(q + (q < 0.0f? -0.5f: 0.5f));
+}
+
+#ifdef RNA_INT8_AVX2
+bool hasAVX2()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }();
+
+    return supported;
+}
+
+// Reduces 4 accumulators at once: sums[c] is the sum of the lanes of c
+__attribute__((target("avx2")))
+void storeSums(int32_t* _sums, __m256i _c0, __m256i _c1, __m256i _c2, __m256i _c3)
+{
+    __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(_c0, _c1), _mm256_hadd_epi32(_c2, _c3));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(_sums), _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1)));
+}
+
+// maddubs multiplies unsigned by signed bytes, and would saturate on (q + 128) * b
+// a * b is computed as |a| * (sign(a) * b) instead: both are in [-127, 127] so the pairwise sums fit in int16
+__attribute__((target("avx2")))
+inline __m256i multiplyAdd(__m256i _c, __m256i _absA, __m256i _signedB, __m256i _ones)
+{
+    return _mm256_add_epi32(_c, _mm256_madd_epi16(_mm256_maddubs_epi16(_absA, _signedB), _ones));
+}
+
+template<bool TWO_ROWS>
+__attribute__((target("avx2")))
+void kernelAVX2(size_t _k, const uint8_t* const* _a, const int8_t* const* _b, int32_t* _sums)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i offset = _mm256_set1_epi8(char(0x80));
+
+    __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256(), c02 = _mm256_setzero_si256(), c03 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256(), c12 = _mm256_setzero_si256(), c13 = _mm256_setzero_si256();
+
+    for (size_t p(0) ; p < _k ; p += 32)
+    {
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[0] + p));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[1] + p));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[2] + p));
+        __m256i b3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[3] + p));
+        __m256i a, absA;
+
+        a = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_a[0] + p)), offset); absA = _mm256_sign_epi8(a, a);
+        c00 = multiplyAdd(c00, absA, _mm256_sign_epi8(b0, a), ones); c01 = multiplyAdd(c01, absA, _mm256_sign_epi8(b1, a), ones);
+        c02 = multiplyAdd(c02, absA, _mm256_sign_epi8(b2, a), ones); c03 = multiplyAdd(c03, absA, _mm256_sign_epi8(b3, a), ones);
+
+        if (TWO_ROWS)
+        {
+            a = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_a[1] + p)), offset); absA = _mm256_sign_epi8(a, a);
+            c10 = multiplyAdd(c10, absA, _mm256_sign_epi8(b0, a), ones); c11 = multiplyAdd(c11, absA, _mm256_sign_epi8(b1, a), ones);
+            c12 = multiplyAdd(c12, absA, _mm256_sign_epi8(b2, a), ones); c13 = multiplyAdd(c13, absA, _mm256_sign_epi8(b3, a), ones);
+        }
+    }
+
+    storeSums(_sums, c00, c01, c02, c03);
+    if (TWO_ROWS)
+        storeSums(_sums + RC, c10, c11, c12, c13);
+}
+
+#ifdef RNA_INT8_VNNI
+bool hasVNNI()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avxvnni");
+    }();
+
+    return supported;
+}
+
+// vpdpbusd accumulates 4 products of unsigned and signed bytes in int32 without saturating:
+// (q + 128) * b is used as is and the offset is removed afterwards with the sums of B
+template<bool TWO_ROWS>
+__attribute__((target("avx2,avxvnni")))
+void kernelVNNI(size_t _k, const uint8_t* const* _a, const int8_t* const* _b, int32_t* _sums)
+{
+    __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256(), c02 = _mm256_setzero_si256(), c03 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256(), c12 = _mm256_setzero_si256(), c13 = _mm256_setzero_si256();
+
+    for (size_t p(0) ; p < _k ; p += 32)
+    {
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[0] + p));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[1] + p));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[2] + p));
+        __m256i b3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_b[3] + p));
+        __m256i a;
+
+        a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_a[0] + p));
+        c00 = _mm256_dpbusd_avx_epi32(c00, a, b0); c01 = _mm256_dpbusd_avx_epi32(c01, a, b1);
+        c02 = _mm256_dpbusd_avx_epi32(c02, a, b2); c03 = _mm256_dpbusd_avx_epi32(c03, a, b3);
+
+        if (TWO_ROWS)
+        {
+            a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_a[1] + p));
+            c10 = _mm256_dpbusd_avx_epi32(c10, a, b0); c11 = _mm256_dpbusd_avx_epi32(c11, a, b1);
+            c12 = _mm256_dpbusd_avx_epi32(c12, a, b2); c13 = _mm256_dpbusd_avx_epi32(c13, a, b3);
+        }
+    }
+
+    storeSums(_sums, c00, c01, c02, c03);
+    if (TWO_ROWS)
+        storeSums(_sums + RC, c10, c11, c12, c13);
+}
+#endif // RNA_INT8_VNNI
+#endif // RNA_INT8_AVX2
+
+template<bool TWO_ROWS>
+void kernelGeneric(size_t _k, const uint8_t* const* _a, const int8_t* const* _b, int32_t* _sums)
+{
+    for (size_t r(0) ; r < (TWO_ROWS? 2: 1) ; r++)
+    {
+        for (size_t c(0) ; c < RC ; c++)
+        {
+            int32_t sum = 0;
+            for (size_t p(0) ; p < _k ; p++)
+                sum += (int32_t(_a[r][p]) - ZERO_POINT) * int32_t(_b[c][p]);
+
+            _sums[r*RC + c] = sum;
+        }
+    }
+}
+
+// Returns true when the sums still include the offset of A
+template<bool TWO_ROWS>
+bool kernel(size_t _k, const uint8_t* const* _a, const int8_t* const* _b, int32_t* _sums)
+{
+    #ifdef RNA_INT8_AVX2
+    #ifdef RNA_INT8_VNNI
+    if (hasVNNI())
+    {
+        kernelVNNI<TWO_ROWS>(_k, _a, _b, _sums);
+        return true;
+    }
+    #endif // RNA_INT8_VNNI
+
+    if (hasAVX2())
+    {
+        kernelAVX2<TWO_ROWS>(_k, _a, _b, _sums);
+        return false;
+    }
+    #endif // RNA_INT8_AVX2
+
+    kernelGeneric<TWO_ROWS>(_k, _a, _b, _sums);
+    return false;
+}
+
+}
+
+size_t int8Stride(size_t _columns)
+{
+    return (_columns + INT8_ALIGNMENT - 1) / INT8_ALIGNMENT * INT8_ALIGNMENT;
+}
+
+void quantizeRows(uint8_t* _dst, size_t _ldd, const real* _src, size_t _rows, size_t _columns, real _scale)
+{
+    real inverseScale = 1.0f / _scale;
+
+    for (size_t i(0) ; i < _rows ; i++)
+    {
+        uint8_t* row = _dst + i*_ldd;
+
+        for (size_t j(0) ; j < _columns ; j++)
+            row[j] = uint8_t(quantizeValue(_src[i*_columns + j], inverseScale) + ZERO_POINT);
+
+        std::fill(row + _columns, row + _ldd, uint8_t(ZERO_POINT));
+    }
+}
+
+void quantizeColumns(uint8_t* _dst, size_t _ldd, const real* _src, size_t _rows, size_t _columns, real _scale)
+{
+    real inverseScale = 1.0f / _scale;
+
+    for (size_t j(0) ; j < _columns ; j++)
+        std::fill(_dst + j*_ldd + _rows, _dst + (j+1)*_ldd, uint8_t(ZERO_POINT));
+
+    for (size_t i(0) ; i < _rows ; i++)
+        for (size_t j(0) ; j < _columns ; j++)
+            _dst[j*_ldd + i] = uint8_t(quantizeValue(_src[i*_columns + j], inverseScale) + ZERO_POINT);
+}
+
+void Int8Matrix::quantize(const real* _src, size_t _rows, size_t _columns)
+{
+    rows = _rows;
+    columns = _columns;
+    stride = int8Stride(_columns);
+
+    values.assign(rows * stride, 0);
+    scales.resize(rows);
+    sums.resize(rows);
+
+    for (size_t i(0) ; i < rows ; i++)
+    {
+        const real* row = _src + i*columns;
+
+        real range = 0.0f;
+        for (size_t j(0) ; j < columns ; j++)
+            range = std::max(range, std::abs(row[j]));
+
+        scales[i] = (range > 0.0f)? range / 127.0f: 1.0f;
+        sums[i] = 0;
+
+        for (size_t j(0) ; j < columns ; j++)
+        {
+            values[i*stride + j] = int8_t(quantizeValue(row[j], 1.0f / scales[i]));
+            sums[i] += values[i*stride + j];
+        }
+    }
+}
+
+void gemmInt8(size_t _m, const uint8_t* _A, real _scaleA, const Int8Matrix& _B,
+              real* _C, size_t _ldc,
+              const GemmEpilogue& _epilogue)
+{
+    size_t n = _B.rows, k = _B.stride;
+
+    size_t rowBlocks = (_m + ROW_BLOCK - 1) / ROW_BLOCK;
+    size_t columnBlocks = (n + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+
+    auto task = [&](size_t _block)
+    {
+        size_t i0 = _block / columnBlocks * ROW_BLOCK, i1 = std::min(i0 + ROW_BLOCK, _m);
+        size_t j0 = _block % columnBlocks * COLUMN_BLOCK, j1 = std::min(j0 + COLUMN_BLOCK, n);
+
+        // The RC rows of B stay in L1 while the rows of A go through
+        for (size_t j(j0) ; j < j1 ; j += RC)
+        {
+            size_t rc = std::min(RC, j1 - j);
+
+            // Missing rows of B are replaced by the last one and their results discarded
+            const int8_t* b[RC];
+            for (size_t c(0) ; c < RC ; c++)
+                b[c] = _B.values.data() + (j + std::min(c, rc-1)) * k;
+
+            for (size_t i(i0) ; i < i1 ; i += RR)
+            {
+                size_t rr = std::min(RR, i1 - i);
+
+                const uint8_t* a[RR];
+                for (size_t r(0) ; r < RR ; r++)
+                    a[r] = _A + (i + std::min(r, rr-1)) * k;
+
+                int32_t sums[RR*RC];
+                bool offset = (rr == 2)? kernel<true>(k, a, b, sums): kernel<false>(k, a, b, sums);
+
+                for (size_t r(0) ; r < rr ; r++)
+                {
+                    for (size_t c(0) ; c < rc ; c++)
+                    {
+                        int32_t sum = sums[r*RC + c] - (offset? ZERO_POINT * _B.sums[j+c]: 0);
+                        _C[(i+r)*_ldc + j+c] = real(sum) * _scaleA * _B.scales[j+c];
+                    }
+                }
+            }
+        }
+
+        if (_epilogue)
+            _epilogue(_C + i0*_ldc + j0, _ldc, i0, j0, i1 - i0, j1 - j0);
+    };
+
+    if (_m*n*k >= PARALLEL_MIN_MACS)
+        ThreadPool::global().run(rowBlocks * columnBlocks, task);
+
+    else
+        for (size_t i(0) ; i < rowBlocks * columnBlocks ; i++)
+            task(i);
+}
+
+}
@@ -0,0 +1,177 @@
+#include "RNA/Maths/optimizers.h"
+
+#include <cmath>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNA_OPTIMIZERS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace rna
+{
+
+static_assert(std::is_same<Tensor::value_type, float>::value, "optimizer kernels are written for single precision");
+
+using real = Tensor::value_type;
+
+namespace
+{
+
+#ifdef RNA_OPTIMIZERS_AVX2
+bool hasAVX2()
+{
+    static const bool supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }();
+
+    return supported;
+}
+
+
+/// AVX2 versions: return the number of elements processed, the rest is left to the scalar loops
+__attribute__((target("avx2,fma")))
+size_t sgdStepAVX2(real* _param, real* _grad, real* _delta, size_t _n, real _gradScale, real _learningRate, real _inertia)
+{
+    const __m256 rate = _mm256_set1_ps(-0.01f * _learningRate * _gradScale);
+    const __m256 inertia = _mm256_set1_ps(_inertia);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 delta = _mm256_fmadd_ps(inertia, _mm256_loadu_ps(_delta + i), _mm256_mul_ps(rate, _mm256_loadu_ps(_grad + i)));
+
+        _mm256_storeu_ps(_delta + i, delta);
+        _mm256_storeu_ps(_param + i, _mm256_add_ps(_mm256_loadu_ps(_param + i), delta));
+        _mm256_storeu_ps(_grad + i, zero);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t adamStepAVX2(real* _param, real* _grad, real* _s, real* _r, size_t _n,
+                    real _gradScale, real _stepSize, real _rho1, real _rho2, real _rCorrection, real _delta)
+{
+    const __m256 scale = _mm256_set1_ps(_gradScale);
+    const __m256 rho1 = _mm256_set1_ps(_rho1), oneMinusRho1 = _mm256_set1_ps(1.0f - _rho1);
+    const __m256 rho2 = _mm256_set1_ps(_rho2), oneMinusRho2 = _mm256_set1_ps(1.0f - _rho2);
+    const __m256 stepSize = _mm256_set1_ps(_stepSize), rCorrection = _mm256_set1_ps(_rCorrection);
+    const __m256 delta = _mm256_set1_ps(_delta);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 g = _mm256_mul_ps(scale, _mm256_loadu_ps(_grad + i));
+
+        __m256 s = _mm256_fmadd_ps(rho1, _mm256_loadu_ps(_s + i), _mm256_mul_ps(oneMinusRho1, g));
+        __m256 r = _mm256_fmadd_ps(rho2, _mm256_loadu_ps(_r + i), _mm256_mul_ps(oneMinusRho2, _mm256_mul_ps(g, g)));
+
+        __m256 denominator = _mm256_add_ps(delta, _mm256_sqrt_ps(_mm256_mul_ps(r, rCorrection)));
+        __m256 param = _mm256_sub_ps(_mm256_loadu_ps(_param + i), _mm256_div_ps(_mm256_mul_ps(stepSize, s), denominator));
+
+        _mm256_storeu_ps(_s + i, s);
+        _mm256_storeu_ps(_r + i, r);
+        _mm256_storeu_ps(_param + i, param);
+        _mm256_storeu_ps(_grad + i, zero);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t rmspropStepAVX2(real* _param, real* _grad, real* _r, size_t _n, real _gradScale, real _learningRate, real _rho, real _delta)
+{
+    const __m256 scale = _mm256_set1_ps(_gradScale);
+    const __m256 rho = _mm256_set1_ps(_rho), oneMinusRho = _mm256_set1_ps(1.0f - _rho);
+    const __m256 learningRate = _mm256_set1_ps(_learningRate);
+    const __m256 delta = _mm256_set1_ps(_delta);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i(0);
+    for ( ; i + 8 <= _n ; i += 8)
+    {
+        __m256 g = _mm256_mul_ps(scale, _mm256_loadu_ps(_grad + i));
+        __m256 r = _mm256_fmadd_ps(rho, _mm256_loadu_ps(_r + i), _mm256_mul_ps(oneMinusRho, _mm256_mul_ps(g, g)));
+
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(learningRate, g), _mm256_sqrt_ps(_mm256_add_ps(delta, r)));
+
+        _mm256_storeu_ps(_r + i, r);
+        _mm256_storeu_ps(_param + i, _mm256_sub_ps(_mm256_loadu_ps(_param + i), step));
+        _mm256_storeu_ps(_grad + i, zero);
+    }
+
+    return i;
+}
+#endif // RNA_OPTIMIZERS_AVX2
+
+}
+
+void sgdStep(real* _param, real* _grad, real* _delta, size_t _n, real _gradScale, real _learningRate, real _inertia)
+{
+    size_t i(0);
+
+    #ifdef RNA_OPTIMIZERS_AVX2
+    if (hasAVX2())
+        i = sgdStepAVX2(_param, _grad, _delta, _n, _gradScale, _learningRate, _inertia);
+    #endif // RNA_OPTIMIZERS_AVX2
+
+    real rate = -0.01f * _learningRate * _gradScale;
+
+    for ( ; i < _n ; i++)
+    {
+        _delta[i] = _inertia * _delta[i] + rate * _grad[i];
+        _param[i] += _delta[i];
+
+        _grad[i] = 0.0f;
+    }
+}
+
+void adamStep(real* _param, real* _grad, real* _s, real* _r, size_t _n,
+              real _gradScale, real _stepSize, real _rho1, real _rho2, real _rCorrection, real _delta)
+{
+    size_t i(0);
+
+    #ifdef RNA_OPTIMIZERS_AVX2
+    if (hasAVX2())
+        i = adamStepAVX2(_param, _grad, _s, _r, _n, _gradScale, _stepSize, _rho1, _rho2, _rCorrection, _delta);
+    #endif // RNA_OPTIMIZERS_AVX2
+
+    for ( ; i < _n ; i++)
+    {
+        real g = _gradScale * _grad[i];
+
+        _s[i] = _rho1 * _s[i] + (1.0f-_rho1) * g;
+        _r[i] = _rho2 * _r[i] + (1.0f-_rho2) * g*g;
+
+        _param[i] -= (_stepSize * _s[i]) / (_delta + std::sqrt(_r[i] * _rCorrection));
+
+        _grad[i] = 0.0f;
+    }
+}
+
+void rmspropStep(real* _param, real* _grad, real* _r, size_t _n, real _gradScale, real _learningRate, real _rho, real _delta)
+{
+    size_t i(0);
+
+    #ifdef RNA_OPTIMIZERS_AVX2
+    if (hasAVX2())
+        i = rmspropStepAVX2(_param, _grad, _r, _n, _gradScale, _learningRate, _rho, _delta);
+    #endif // RNA_OPTIMIZERS_AVX2
+
+    for ( ; i < _n ; i++)
+    {
+        real g = _gradScale * _grad[i];
+
+        _r[i] = _rho * _r[i] + (1.0f-_rho) * g*g;
+        _param[i] -= (_learningRate * g) / std::sqrt(_delta + _r[i]);
+
+        _grad[i] = 0.0f;
+    }
+}
+
+}
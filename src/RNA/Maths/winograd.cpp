@@ -0,0 +1,139 @@
+#include "RNA/Maths/winograd.h"
+#include "RNA/Maths/gemm.h"
+
+namespace rna
+{
+
+void winogradKernel(Tensor::value_type* _U, size_t _stride, const Tensor::value_type* _g)
+{
+    // U = G g G^T, with G = [1 0 0; .5 .5 .5; .5 -.5 .5; 0 0 1]
+    Tensor::value_type t[4][3];
+
+    for (size_t j(0) ; j < 3 ; j++)
+    {
+        t[0][j] = _g[j];
+        t[1][j] = 0.5f * (_g[j] + _g[3+j] + _g[6+j]);
+        t[2][j] = 0.5f * (_g[j] - _g[3+j] + _g[6+j]);
+        t[3][j] = _g[6+j];
+    }
+
+    for (size_t i(0) ; i < 4 ; i++)
+    {
+        _U[(4*i + 0) * _stride] = t[i][0];
+        _U[(4*i + 1) * _stride] = 0.5f * (t[i][0] + t[i][1] + t[i][2]);
+        _U[(4*i + 2) * _stride] = 0.5f * (t[i][0] - t[i][1] + t[i][2]);
+        _U[(4*i + 3) * _stride] = t[i][2];
+    }
+}
+
+void winogradCorrelate(Tensor::value_type* _output, const Tensor::value_type* _input, const Tensor::value_type* _U,
+                       size_t _batchSize, size_t _inputChannels, size_t _outputChannels,
+                       size_t _width, size_t _height, size_t _padding,
+                       std::vector<Tensor::value_type>& _workspace)
+{
+    size_t outputWidth = _width + 2*_padding - 2, outputHeight = _height + 2*_padding - 2;
+    size_t tilesX = (outputWidth + 1) / 2, tilesY = (outputHeight + 1) / 2;
+
+    size_t tiles = tilesX * tilesY;
+    size_t columns = _batchSize * tiles; // tiles of every sample are processed by the same products
+
+    _workspace.resize(16 * columns * (_inputChannels + _outputChannels));
+
+    Tensor::value_type* V = _workspace.data();                          // 16 x inputChannels x columns
+    Tensor::value_type* M = _workspace.data() + 16*_inputChannels*columns; // 16 x outputChannels x columns
+
+    // Input transform: V = B^T d B
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        for (size_t c(0) ; c < _inputChannels ; c++)
+        {
+            const Tensor::value_type* image = _input + (n*_inputChannels + c) * _width*_height;
+
+            for (size_t tx(0) ; tx < tilesX ; tx++)
+            {
+                for (size_t ty(0) ; ty < tilesY ; ty++)
+                {
+                    Tensor::value_type d[4][4], t[4][4];
+
+                    for (size_t i(0) ; i < 4 ; i++)
+                    {
+                        for (size_t j(0) ; j < 4 ; j++)
+                        {
+                            // Unsigned wraparound sends out of bounds coordinates past the image
+                            size_t x = 2*tx + i - _padding, y = 2*ty + j - _padding;
+                            d[i][j] = (x < _width && y < _height)? image[x*_height + y]: 0.0f;
+                        }
+                    }
+
+                    for (size_t j(0) ; j < 4 ; j++)
+                    {
+                        t[0][j] = d[0][j] - d[2][j];
+                        t[1][j] = d[1][j] + d[2][j];
+                        t[2][j] = d[2][j] - d[1][j];
+                        t[3][j] = d[1][j] - d[3][j];
+                    }
+
+                    size_t column = n*tiles + tx*tilesY + ty;
+                    Tensor::value_type* v = V + c*columns + column;
+
+                    for (size_t i(0) ; i < 4 ; i++)
+                    {
+                        v[(4*i + 0) * _inputChannels*columns] = t[i][0] - t[i][2];
+                        v[(4*i + 1) * _inputChannels*columns] = t[i][1] + t[i][2];
+                        v[(4*i + 2) * _inputChannels*columns] = t[i][2] - t[i][1];
+                        v[(4*i + 3) * _inputChannels*columns] = t[i][1] - t[i][3];
+                    }
+                }
+            }
+        }
+    }
+
+    // Element-wise products summed over input channels: one gemm per Winograd coefficient
+    for (size_t xi(0) ; xi < 16 ; xi++)
+    {
+        gemm(false, false, _outputChannels, columns, _inputChannels,
+             1.0f, _U + xi*_outputChannels*_inputChannels, _inputChannels, V + xi*_inputChannels*columns, columns,
+             0.0f, M + xi*_outputChannels*columns, columns);
+    }
+
+    // Output transform: Y = A^T m A, with A^T = [1 1 1 0; 0 1 -1 -1]
+    for (size_t n(0) ; n < _batchSize ; n++)
+    {
+        for (size_t o(0) ; o < _outputChannels ; o++)
+        {
+            Tensor::value_type* image = _output + (n*_outputChannels + o) * outputWidth*outputHeight;
+
+            for (size_t tx(0) ; tx < tilesX ; tx++)
+            {
+                for (size_t ty(0) ; ty < tilesY ; ty++)
+                {
+                    const Tensor::value_type* m = M + o*columns + n*tiles + tx*tilesY + ty;
+                    Tensor::value_type t[2][4];
+
+                    for (size_t j(0) ; j < 4 ; j++)
+                    {
+                        Tensor::value_type m0 = m[(0 + j) * _outputChannels*columns];
+                        Tensor::value_type m1 = m[(4 + j) * _outputChannels*columns];
+                        Tensor::value_type m2 = m[(8 + j) * _outputChannels*columns];
+                        Tensor::value_type m3 = m[(12 + j) * _outputChannels*columns];
+
+                        t[0][j] = m0 + m1 + m2;
+                        t[1][j] = m1 - m2 - m3;
+                    }
+
+                    for (size_t i(0) ; i < 2 && 2*tx+i < outputWidth ; i++)
+                    {
+                        Tensor::value_type* y = image + (2*tx + i)*outputHeight + 2*ty;
+
+                        y[0] = t[i][0] + t[i][1] + t[i][2];
+
+                        if (2*ty + 1 < outputHeight)
+                            y[1] = t[i][1] - t[i][2] - t[i][3];
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
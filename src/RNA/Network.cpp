@@ -1,13 +1,36 @@
 #include "RNA/RNA.h"
+#include "Utility/Error.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
 
 namespace rna
 {
 
-Network::Network()
-{ }
+Network::Network():
+    fusion(false)
+{
+    #ifndef USE_OPENCL
+    training = true;
+    keepAllOutputs = false;
+    checkpointInterval = 0;
+    shareGradients = false;
+    #endif // USE_OPENCL
+}
 
 Network::~Network()
 {
@@ -43,6 +66,9 @@ Network::Network(const Network& _network)
         else if ("Tanh" == layerType)
             layer = new Tanh();
 
+        else if ("Sigmoid" == layerType)
+            layer = new Sigmoid();
+
         else if ("ReLU" == layerType)
             layer = new ReLU();
 
@@ -74,6 +100,45 @@ void Network::add(Layer* _layer)
     if (context)
         _layer->openCL(context);
     #endif // USE_OPENCL
+
+    updateSteps();
+}
+
+void Network::setFusion(bool _fuse)
+{
+    fusion = _fuse;
+
+    updateSteps();
+}
+
+void Network::updateSteps()
+{
+    steps.clear();
+
+    for (size_t l(0) ; l < layers.size() ; l++)
+    {
+        // Apply the activation in the epilogue of the Linear layer, saving two passes over its output
+        if (Linear* linear = dynamic_cast<Linear*>(layers[l]))
+        {
+            Activation* activation = (fusion && l+1 < layers.size())? dynamic_cast<Activation*>(layers[l+1]): nullptr;
+            if (!Linear::canFuse(activation))
+                activation = nullptr;
+
+            if (linear->getActivation() != activation)
+            {
+                linear->setActivation(activation);
+
+                #ifdef USE_OPENCL
+                if (context)
+                    linear->openCL(context);
+                #endif // USE_OPENCL
+            }
+        }
+
+        Activation* activation = dynamic_cast<Activation*>(layers[l]);
+        if (!activation || !activation->getFusedLayer())
+            steps.push_back(layers[l]);
+    }
 }
 
 void Network::clear()
@@ -82,6 +147,7 @@ void Network::clear()
         delete layers[i];
 
     layers.clear();
+    steps.clear();
 }
 
 #ifdef USE_OPENCL
@@ -131,13 +197,13 @@ const Tensor& Network::feedForward(cl::CommandQueue& _commandQueue, const Tensor
     _inputBatch.openCL(context);
 
 
-    layers.front()->feedForward(_commandQueue, _inputBatch);
+    steps.front()->feedForward(_commandQueue, _inputBatch);
 
-    for (unsigned l(1) ; l < layers.size() ; ++l)
-        layers[l]->feedForward(_commandQueue, layers[l-1]->getOutput());
+    for (unsigned l(1) ; l < steps.size() ; ++l)
+        steps[l]->feedForward(_commandQueue, steps[l-1]->getOutput());
 
 
-    return layers.back()->getOutput();
+    return steps.back()->getOutput();
 }
 
 void Network::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatch, const Tensor& _outputGradBatch)
@@ -148,37 +214,200 @@ void Network::backprop(cl::CommandQueue& _commandQueue, const Tensor& _inputBatc
     const Tensor* g = &_outputGradBatch;
 
 
-    for (unsigned l(layers.size()-1) ; l >= 1 ; l--)
+    for (unsigned l(steps.size()-1) ; l >= 1 ; l--)
     {
-        layers[l]->backprop(_commandQueue, layers[l-1]->getOutput(), *g);
-        g = &layers[l]->getInputGrad();
+        steps[l]->backprop(_commandQueue, steps[l-1]->getOutput(), *g);
+        g = &steps[l]->getInputGrad();
     }
 
-    layers[0]->backprop(_commandQueue, _inputBatch, *g);
+    steps[0]->backprop(_commandQueue, _inputBatch, *g);
 }
 
 #else
+Network* Network::clone() const
+{
+    Network* network = new Network();
+    network->fusion = fusion;
+
+    for (Layer* layer: layers)
+    {
+        Layer* copy = layer->clone();
+        if (!copy)
+        {
+            delete network;
+            return nullptr;
+        }
+
+        network->add(copy);
+    }
+
+    network->training = training;
+    network->checkpointInterval = checkpointInterval;
+    network->shareGradients = shareGradients;
+
+    return network;
+}
+
+void Network::setBatchMode(bool _useMinibatch)
+{
+    for (Layer* l: layers)
+        l->setBatchMode(_useMinibatch);
+}
+
+void Network::setTraining(bool _training)
+{
+    training = _training;
+
+    for (Layer* l: layers)
+        l->setTraining(_training);
+
+    if (training)
+        return;
+
+    // Free what training kept for backprop: the outputs of all steps but the last one, and every input gradient
+    for (size_t l(0) ; l < steps.size() ; l++)
+    {
+        Tensor released[2];
+
+        if (l+1 < steps.size())
+            steps[l]->swapOutput(released[0]);
+
+        steps[l]->swapInputGrad(released[1]);
+    }
+
+    gradients[0] = Tensor();
+    gradients[1] = Tensor();
+    recomputed.clear();
+}
+
+void Network::setCheckpointing(size_t _interval)
+{
+    checkpointInterval = _interval;
+}
+
+void Network::setGradientSharing(bool _share)
+{
+    shareGradients = _share;
+}
+
+void Network::quantize(const std::vector<Example>& _calibration)
+{
+    std::vector<Tensor::value_type> ranges(steps.size(), 0.0f);
+
+    // Layers run as in inference, but every intermediate output is kept
+    const bool wasTraining = training;
+    setTraining(false);
+    keepAllOutputs = true;
+
+    for (const Example& example: _calibration)
+    {
+        feedForward(example.input);
+
+        for (size_t l(0) ; l < steps.size() ; l++)
+        {
+            if (!dynamic_cast<Linear*>(steps[l]) && !dynamic_cast<Convolutional*>(steps[l]))
+                continue;
+
+            const Tensor& input = (l == 0)? example.input: steps[l-1]->getOutput();
+
+            for (size_t i(0) ; i < input.nElements() ; i++)
+                ranges[l] = std::max(ranges[l], std::abs(input[i]));
+        }
+    }
+
+    keepAllOutputs = false;
+    setTraining(wasTraining);
+
+    for (size_t l(0) ; l < steps.size() ; l++)
+    {
+        if (Linear* linear = dynamic_cast<Linear*>(steps[l]))
+            linear->quantize(ranges[l]);
+
+        else if (Convolutional* convolutional = dynamic_cast<Convolutional*>(steps[l]))
+            convolutional->quantize(ranges[l]);
+    }
+}
+
 const Tensor& Network::feedForward(const Tensor& _input)
 {
-    layers.front()->feedForward(_input);
+    // Steps whose output is not kept write into a buffer lent by the network,
+    // given back once the next step has consumed it: two buffers suffice for a chain
+    for (size_t l(0) ; l < steps.size() ; l++)
+    {
+        if (!keepsOutput(l))
+            steps[l]->swapOutput(activations[l%2]);
 
-    for (unsigned l(1) ; l < layers.size() ; ++l)
-        layers[l]->feedForward( layers[l-1]->getOutput() );
+        steps[l]->feedForward(l? steps[l-1]->getOutput(): _input);
 
-    return layers.back()->getOutput();
+        if (l && !keepsOutput(l-1))
+            steps[l-1]->swapOutput(activations[(l-1)%2]);
+    }
+
+    return steps.back()->getOutput();
 }
 
 void Network::backprop(const Tensor& _input, const Tensor& _outputGrad)
 {
-    const Tensor* g = &_outputGrad;
+    if (!training)
+    {
+        Error::add(ErrorType::USER_ERROR, "Network::backprop => Intermediate outputs are not kept in inference mode, call setTraining(true) first");
+        return;
+    }
+
+    size_t segmentEnd(0);
 
-    for (unsigned l(layers.size()-1) ; l >= 1 ; l--)
+    // With gradient sharing, the input gradient of a step is dead once the previous step has consumed it,
+    // so they share two buffers which keep their capacity from one minibatch to the next
+    for (size_t l(steps.size()) ; l-- > 0 ; )
     {
-        layers[l]->backprop(layers[l-1]->getOutput(), *g);
-        g = &layers[l]->getInputGrad();
+        // Recompute the outputs dropped since the previous checkpoint
+        if (l && keepsOutput(l) && !keepsOutput(l-1))
+        {
+            size_t segmentBegin(l-1);
+            while (segmentBegin && !keepsOutput(segmentBegin-1))
+                segmentBegin--;
+
+            segmentEnd = l;
+            if (recomputed.size() < segmentEnd - segmentBegin)
+                recomputed.resize(segmentEnd - segmentBegin);
+
+            for (size_t s(segmentBegin) ; s < segmentEnd ; s++)
+            {
+                steps[s]->swapOutput(recomputed[s - segmentBegin]);
+                steps[s]->feedForward(s? steps[s-1]->getOutput(): _input);
+            }
+        }
+
+        if (shareGradients && l)
+            steps[l]->swapInputGrad(gradients[l%2]);
+
+        steps[l]->backprop(l? steps[l-1]->getOutput(): _input, (l+1 < steps.size())? steps[l+1]->getInputGrad(): _outputGrad);
+
+        if (shareGradients && l+1 < steps.size())
+            steps[l+1]->swapInputGrad(gradients[(l+1)%2]);
+
+        // Release the segment once its first step is done
+        if (!keepsOutput(l) && (!l || keepsOutput(l-1)))
+        {
+            for (size_t s(l) ; s < segmentEnd ; s++)
+                steps[s]->swapOutput(recomputed[s - l]);
+        }
     }
+}
+
+bool Network::keepsOutput(size_t _step) const
+{
+    if (_step+1 == steps.size() || keepAllOutputs)
+        return true;
+
+    if (!training)
+        return false;
 
-    layers[0]->backprop(_input, *g);
+    if (!checkpointInterval)
+        return true;
+
+    // Dropout draws a new mask at each run, so its output cannot be recomputed
+    return (_step+1) % checkpointInterval == 0 || dynamic_cast<Dropout*>(steps[_step]);
 }
 #endif // USE_OPENCL
 
@@ -191,7 +420,7 @@ cl::Context& Network::getContext()
 
 const Tensor& Network::getOutput() const
 {
-    return layers.back()->getOutput();
+    return steps.back()->getOutput();
 }
 
 Layer* Network::getLayer(size_t _index) const
@@ -219,9 +448,292 @@ void Network::getParams(std::vector<Tensor*>& _params, std::vector<Tensor*>& _pa
         layer->getParams(_params, _paramsGrad);
 }
 
-bool Network::saveToFile(const std::string& _file) const
+void Network::getParams(Tensor& _params) const
 {
-    std::ofstream file(_file);
+    std::vector<Tensor*> params, paramsGrad;
+    getParams(params, paramsGrad);
+
+    #ifdef USE_OPENCL
+    if (context)
+    {
+        cl::CommandQueue comQ(context, false);
+
+        for (Tensor* param: params)
+            comQ.enqueueRead(*param, CL_FALSE);
+
+        comQ.join();
+    }
+    #endif // USE_OPENCL
+
+    size_t size(0);
+    for (const Tensor* param: params)
+        size += param->nElements();
+
+    _params.resize({size});
+
+    Tensor::value_type* dst = _params.data();
+    for (const Tensor* param: params)
+    {
+        std::memcpy(dst, param->data(), param->nElements() * sizeof(Tensor::value_type));
+        dst += param->nElements();
+    }
+}
+
+bool Network::setParams(const Tensor& _params)
+{
+    std::vector<Tensor*> params, paramsGrad;
+    getParams(params, paramsGrad);
+
+    size_t size(0);
+    for (const Tensor* param: params)
+        size += param->nElements();
+
+    if (_params.nElements() != size)
+    {
+        std::cout << "Network::setParams => Expected " << size << " parameters, got " << _params.nElements() << std::endl;
+        return false;
+    }
+
+    const Tensor::value_type* src = _params.data();
+    for (Tensor* param: params)
+    {
+        std::memcpy(param->data(), src, param->nElements() * sizeof(Tensor::value_type));
+        src += param->nElements();
+    }
+
+    #ifdef USE_OPENCL
+    if (context)
+    {
+        cl::CommandQueue comQ(context, false);
+
+        for (Tensor* param: params)
+            comQ.enqueueWrite(*param, CL_FALSE);
+
+        comQ.join();
+    }
+    #endif // USE_OPENCL
+
+    for (Layer* layer: layers)
+        layer->parametersChanged();
+
+    return true;
+}
+
+namespace
+{
+
+/// Binary model files
+// Header, then the description of the layers in the text format but without parameter values,
+// then the parameters of every layer in getParams order, as little endian values whatever the host
+// Each tensor starts on a PAYLOAD_ALIGNMENT boundary; the payload is mapped in memory when loading
+const char BINARY_MAGIC[8] = {'R', 'N', 'A', 'M', 'O', 'D', 'E', 'L'};
+const uint32_t BINARY_VERSION = 1;
+const uint64_t PAYLOAD_ALIGNMENT = 64;
+
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t valueSize; // sizeof(Tensor::value_type)
+    uint64_t layerCount;
+    uint64_t descriptionOffset, descriptionSize;
+    uint64_t payloadOffset, payloadSize;
+};
+
+const size_t HEADER_SIZE = 56; // Serialized size of BinaryHeader, field by field
+
+// Integers are written least significant byte first
+template<typename T>
+void putLittleEndian(unsigned char*& _bytes, T _value)
+{
+    for (size_t i(0) ; i < sizeof(T) ; i++)
+        *_bytes++ = (unsigned char)(_value >> (8*i));
+}
+
+template<typename T>
+void getLittleEndian(const unsigned char*& _bytes, T& _value)
+{
+    _value = 0;
+    for (size_t i(0) ; i < sizeof(T) ; i++)
+        _value |= T(*_bytes++) << (8*i);
+}
+
+void writeHeader(std::ostream& _file, const BinaryHeader& _header)
+{
+    unsigned char bytes[HEADER_SIZE];
+    unsigned char* b = bytes;
+
+    std::copy(_header.magic, _header.magic + sizeof(_header.magic), b); b += sizeof(_header.magic);
+    putLittleEndian(b, _header.version);
+    putLittleEndian(b, _header.valueSize);
+    putLittleEndian(b, _header.layerCount);
+    putLittleEndian(b, _header.descriptionOffset);
+    putLittleEndian(b, _header.descriptionSize);
+    putLittleEndian(b, _header.payloadOffset);
+    putLittleEndian(b, _header.payloadSize);
+
+    _file.write(reinterpret_cast<const char*>(bytes), HEADER_SIZE);
+}
+
+bool readHeader(std::istream& _file, BinaryHeader& _header)
+{
+    unsigned char bytes[HEADER_SIZE];
+    if (!_file.read(reinterpret_cast<char*>(bytes), HEADER_SIZE))
+        return false;
+
+    const unsigned char* b = bytes;
+
+    std::copy(b, b + sizeof(_header.magic), _header.magic); b += sizeof(_header.magic);
+    getLittleEndian(b, _header.version);
+    getLittleEndian(b, _header.valueSize);
+    getLittleEndian(b, _header.layerCount);
+    getLittleEndian(b, _header.descriptionOffset);
+    getLittleEndian(b, _header.descriptionSize);
+    getLittleEndian(b, _header.payloadOffset);
+    getLittleEndian(b, _header.payloadSize);
+
+    return true;
+}
+
+bool littleEndianHost()
+{
+    const uint32_t one = 1;
+
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+
+    return first == 1;
+}
+
+// Reverses the bytes of each value, for big endian hosts
+void swapBytes(Tensor::value_type* _values, size_t _n)
+{
+    static_assert(sizeof(Tensor::value_type) == sizeof(uint32_t), "Binary model files store single precision values");
+
+    for (size_t i(0) ; i < _n ; i++)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, _values + i, sizeof(bits));
+
+        bits = (bits >> 24) | ((bits >> 8) & 0xff00) | ((bits << 8) & 0xff0000) | (bits << 24);
+        std::memcpy(_values + i, &bits, sizeof(bits));
+    }
+}
+
+void writeValues(std::ostream& _file, const Tensor& _tensor)
+{
+    if (littleEndianHost())
+    {
+        _file.write(reinterpret_cast<const char*>(_tensor.data()), _tensor.nElements() * sizeof(Tensor::value_type));
+        return;
+    }
+
+    std::vector<Tensor::value_type> values(_tensor.data(), _tensor.data() + _tensor.nElements());
+    swapBytes(values.data(), values.size());
+
+    _file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Tensor::value_type));
+}
+
+// Read-only mapping of a whole file, empty when the system refuses it
+class MappedFile
+{
+    public:
+        MappedFile(const std::string& _file):
+            address(nullptr), length(0)
+        {
+            #ifdef _WIN32
+            file = CreateFileA(_file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            mapping = nullptr;
+
+            LARGE_INTEGER size;
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || !size.QuadPart)
+                return;
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return;
+
+            address = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            length = address? uint64_t(size.QuadPart): 0;
+            #else
+            int descriptor = open(_file.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                return;
+
+            struct stat status;
+            if (!fstat(descriptor, &status) && status.st_size > 0)
+            {
+                void* mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+                if (mapped != MAP_FAILED)
+                {
+                    address = static_cast<const char*>(mapped);
+                    length = status.st_size;
+                }
+            }
+
+            close(descriptor);
+            #endif // _WIN32
+        }
+
+        ~MappedFile()
+        {
+            #ifdef _WIN32
+            if (address)
+                UnmapViewOfFile(address);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+            #else
+            if (address)
+                munmap(const_cast<char*>(address), length);
+            #endif // _WIN32
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return address; }
+        uint64_t size() const { return length; }
+
+    private:
+        const char* address;
+        uint64_t length;
+
+        #ifdef _WIN32
+        HANDLE file, mapping;
+        #endif // _WIN32
+};
+
+uint64_t alignPayload(uint64_t _offset)
+{
+    return (_offset + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+}
+
+// Offsets of each tensor relative to the start of the payload, followed by the total size
+std::vector<uint64_t> payloadLayout(const std::vector<Tensor*>& _params)
+{
+    std::vector<uint64_t> offsets;
+    uint64_t offset = 0;
+
+    for (const Tensor* param: _params)
+    {
+        offset = alignPayload(offset);
+        offsets.push_back(offset);
+
+        offset += param->nElements() * sizeof(Tensor::value_type);
+    }
+    offsets.push_back(offset);
+
+    return offsets;
+}
+
+}
+
+bool Network::saveToFile(const std::string& _file, FileFormat _format) const
+{
+    std::ofstream file(_file, std::ios::binary);
 
     if (!file)
     {
@@ -249,19 +761,17 @@ bool Network::saveToFile(const std::string& _file) const
     }
     #endif // USE_OPENCL
 
-    for (const Layer* layer: layers)
-    {
-        layer->saveToFile(file);
-
-        file << std::endl;
-    }
+    if (_format == FileFormat::BINARY)
+        saveBinary(file);
+    else
+        saveText(file);
 
-    return true;
+    return bool(file);
 }
 
 bool Network::loadFromFile(const std::string& _file)
 {
-    std::ifstream file(_file);
+    std::ifstream file(_file, std::ios::binary);
 
     if (!file)
     {
@@ -274,54 +784,254 @@ bool Network::loadFromFile(const std::string& _file)
     if (layers.size())
         std::cout << "Network is not empty: just saying..." << std::endl;
 
+    char magic[sizeof(BINARY_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+
+    if (file && std::equal(magic, magic + sizeof(magic), BINARY_MAGIC))
+        return loadBinary(_file, file);
+
+    file.clear();
+    file.seekg(0);
+    loadText(file);
+
+    return true;
+}
+
+bool Network::convertToBinary(const std::string& _textFile, const std::string& _binaryFile)
+{
+    Network network;
+
+    return network.loadFromFile(_textFile) && network.saveToFile(_binaryFile, FileFormat::BINARY);
+}
+
+Layer* Network::loadLayer(const std::string& _layerType, std::ifstream& _file) const
+{
+    if ("Linear" == _layerType)
+        return new Linear(_file);
+
+    else if ("Convolutional" == _layerType)
+        return new Convolutional(_file);
+
+
+    else if ("LogSoftMax" == _layerType)
+        return new LogSoftMax();
+
+    else if ("MaxPooling" == _layerType)
+        return new MaxPooling(_file);
+
+    else if ("Reshape" == _layerType)
+        return new Reshape(_file);
+
+    else if ("Dropout" == _layerType)
+        return new Dropout(_file);
+
+
+    else if ("Tanh" == _layerType)
+        return new Tanh();
+
+    else if ("Sigmoid" == _layerType)
+        return new Sigmoid();
+
+    else if ("ReLU" == _layerType)
+        return new ReLU();
+
+    else if ("ELU" == _layerType)
+        return new ELU(_file);
+
+    std::cout << "Unknown layer type: " << _layerType << std::endl;
+    return nullptr;
+}
+
+void Network::saveText(std::ofstream& _file) const
+{
+    // Enough digits for the values to be read back exactly
+    _file.precision(std::numeric_limits<Tensor::value_type>::max_digits10);
+
+    for (const Layer* layer: layers)
+    {
+        layer->saveToFile(_file);
+
+        _file << std::endl;
+    }
+}
+
+void Network::saveBinary(std::ofstream& _file) const
+{
+    BinaryHeader header = {};
+    std::copy(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC), header.magic);
+    header.version = BINARY_VERSION;
+    header.valueSize = sizeof(Tensor::value_type);
+    header.layerCount = layers.size();
+    header.descriptionOffset = HEADER_SIZE;
+
+    writeHeader(_file, header);
+
+    // Description: layers with parameters only list the dimensions of their tensors
+    for (Layer* layer: layers)
+    {
+        std::vector<Tensor*> params, paramsGrad;
+        layer->getParams(params, paramsGrad);
+
+        if (params.empty())
+            layer->saveToFile(_file);
+        else
+        {
+            _file << layer->getType() << std::endl;
+
+            for (const Tensor* param: params)
+            {
+                _file << param->nDimensions();
+                for (size_t i(0) ; i < param->nDimensions() ; i++)
+                    _file << " " << param->size(i);
+                _file << std::endl;
+            }
+        }
+
+        _file << std::endl;
+    }
+
+    header.descriptionSize = uint64_t(_file.tellp()) - header.descriptionOffset;
+    header.payloadOffset = alignPayload(header.descriptionOffset + header.descriptionSize);
+
+    // Payload
+    std::vector<Tensor*> params, paramsGrad;
+    getParams(params, paramsGrad);
+
+    std::vector<uint64_t> offsets = payloadLayout(params);
+    const char padding[PAYLOAD_ALIGNMENT] = {};
+
+    for (size_t i(0) ; i < params.size() ; i++)
+    {
+        uint64_t position = uint64_t(_file.tellp());
+        _file.write(padding, header.payloadOffset + offsets[i] - position);
+
+        writeValues(_file, *params[i]);
+    }
+
+    header.payloadSize = offsets.back();
+
+    _file.seekp(0);
+    writeHeader(_file, header);
+}
+
+void Network::loadText(std::ifstream& _file)
+{
     while (1)
     {
-        Layer* layer = nullptr;
         std::string layerType;
 
-        file >> layerType;
+        _file >> layerType;
 
-        if (file.peek() == EOF)
+        if (_file.peek() == EOF)
             break;
 
+        if (Layer* layer = loadLayer(layerType, _file))
+            add(layer);
+    }
+}
 
-        if ("Linear" == layerType)
-            layer = new Linear(file);
+bool Network::loadBinary(const std::string& _fileName, std::ifstream& _file)
+{
+    BinaryHeader header = {};
 
-        else if ("Convolutional" == layerType)
-            layer = new Convolutional(file);
+    _file.seekg(0);
+    if (!readHeader(_file, header) || header.version != BINARY_VERSION || header.valueSize != sizeof(Tensor::value_type))
+    {
+        std::cout << "Network::loadFromFile => Unsupported binary file (version " << header.version << ")" << std::endl;
+        return false;
+    }
 
+    // Build the layers from their description
+    std::vector<Layer*> loaded;
+    _file.seekg(header.descriptionOffset);
 
-        else if ("LogSoftMax" == layerType)
-            layer = new LogSoftMax();
+    for (uint64_t l(0) ; l < header.layerCount && _file ; l++)
+    {
+        std::string layerType;
+        _file >> layerType;
 
-        else if ("MaxPooling" == layerType)
-            layer = new MaxPooling(file);
+        Layer* layer = nullptr;
 
-        else if ("Reshape" == layerType)
-            layer = new Reshape(file);
+        if ("Linear" == layerType || "Convolutional" == layerType)
+        {
+            std::vector<coords_t> dimensions(2); // Weights and bias
+            for (coords_t& tensorDimensions: dimensions)
+            {
+                size_t nDimensions(0);
+                _file >> nDimensions;
+
+                tensorDimensions.resize(nDimensions);
+                for (size_t& dimension: tensorDimensions)
+                    _file >> dimension;
+            }
+
+            // Parameters are filled from the payload
+            if ("Linear" == layerType && dimensions[0].size() == 2)
+                layer = new Linear(dimensions[0][1], dimensions[0][0], false);
+
+            else if ("Convolutional" == layerType && dimensions[0].size() == 4 && dimensions[1].size() == 3)
+            {
+                const coords_t& w = dimensions[0];
+                const coords_t& b = dimensions[1];
+                layer = new Convolutional({w[1], b[1]+w[2]-1, b[2]+w[3]-1}, {w[2], w[3]}, w[0], false);
+            }
+        }
+        else
+            layer = loadLayer(layerType, _file);
 
-        else if ("Dropout" == layerType)
-            layer = new Dropout(file);
+        if (!layer)
+            break;
 
+        loaded.push_back(layer);
+    }
 
-        else if ("Tanh" == layerType)
-            layer = new Tanh();
+    if (loaded.size() != header.layerCount || !_file)
+    {
+        std::cout << "Network::loadFromFile => Invalid layer description" << std::endl;
 
-        else if ("ReLU" == layerType)
-            layer = new ReLU();
+        for (Layer* layer: loaded)
+            delete layer;
+        return false;
+    }
 
-        else if ("ELU" == layerType)
-            layer = new ELU(file);
+    std::vector<Tensor*> params, paramsGrad;
+    for (Layer* layer: loaded)
+        layer->getParams(params, paramsGrad);
 
+    std::vector<uint64_t> offsets = payloadLayout(params);
+
+    // Copy the parameters from a mapping of the payload, or read them when the file can not be mapped
+    MappedFile mapping(_fileName);
+    bool mapped = mapping.data() && mapping.size() >= header.payloadOffset + header.payloadSize;
+
+    for (size_t i(0) ; i < params.size() && _file && offsets.back() == header.payloadSize ; i++)
+    {
+        size_t bytes = params[i]->nElements() * sizeof(Tensor::value_type);
+
+        if (mapped)
+            std::memcpy(params[i]->data(), mapping.data() + header.payloadOffset + offsets[i], bytes);
         else
-            std::cout << "Unknown layer type: " << layerType << std::endl;
+        {
+            _file.seekg(header.payloadOffset + offsets[i]);
+            _file.read(reinterpret_cast<char*>(params[i]->data()), bytes);
+        }
 
+        if (!littleEndianHost())
+            swapBytes(params[i]->data(), params[i]->nElements());
+    }
 
-        if (layer)
-            add(layer);
+    if (offsets.back() != header.payloadSize || !_file)
+    {
+        std::cout << "Network::loadFromFile => Parameters do not match the layer description" << std::endl;
+
+        for (Layer* layer: loaded)
+            delete layer;
+        return false;
     }
 
+    for (Layer* layer: loaded)
+        add(layer);
+
     return true;
 }
 
@@ -1,4 +1,6 @@
 #include "RNA/Optimizers/Adam.h"
+#include "RNA/Maths/optimizers.h"
+#include "RNA/kernels.h"
 
 #include <cmath>
 
@@ -21,51 +23,51 @@ Adam::Adam(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad, Ten
 }
 
 #ifdef USE_OPENCL
-void Adam::updateParams(cl::CommandQueue& _commandQueue)
-{ // TODO: implement Adam on GPU
+void Adam::updateParams(cl::CommandQueue& _commandQueue, Tensor::value_type _gradScale)
+{
+    iteration++;
+
+    // Bias corrections are folded into the step size and the scale of r
+    Tensor::value_type stepSize = learningRate / (1.0f - pow(rho1, iteration));
+    Tensor::value_type rCorrection = 1.0f / (1.0f - pow(rho2, iteration));
+
+    updateKernel.setArg(1, stepSize);
+    updateKernel.setArg(4, rCorrection);
+
+    updateKernel.setArg(0, _gradScale);
+    enqueueUpdate(_commandQueue, 6, { &s, &r });
 }
 
 void Adam::openCL(cl::Context& _context)
 {
-    Optimizer::openCL(_context);
-
-    auto& p = _context.getProgram("Kernels/Adam.cl");
-    updateKernel.create(p, "updateParam");
+    auto& p = getProgram(_context, "adam.cl");
+    updateKernel.create(p, "updateParams");
 
-    updateKernel.setArg(3, learningRate);
-    updateKernel.setArg(4, rho1);
-    updateKernel.setArg(5, rho2);
-    updateKernel.setArg(6, delta);
+    updateKernel.setArg(2, rho1);
+    updateKernel.setArg(3, rho2);
+    updateKernel.setArg(5, delta);
 
     for (size_t i(0); i < r.size(); i++)
+    {
+        s[i].openCL(_context);
         r[i].openCL(_context);
+    }
 }
 
 #else
-void Adam::updateParams()
+void Adam::updateParams(Tensor::value_type _gradScale)
 {
     iteration++;
 
-    for (size_t i(0); i < params->size(); i++)
-    {
-        Tensor& param = *(*params)[i];
-        Tensor& paramGrad = *(*paramsGrad)[i];
-
-        for (unsigned j(0); j < param.nElements(); j++)
-        {
-            s[i][j] = rho1 * s[i][j] + (1.0f-rho1) * paramGrad[j];
-            r[i][j] = rho2 * r[i][j] + (1.0f-rho2) * paramGrad[j]*paramGrad[j];
-
-            Tensor::value_type biasCorrectedS = s[i][j] / (1.0f - pow(rho1, iteration));
-            Tensor::value_type biasCorrectedR = r[i][j] / (1.0f - pow(rho2, iteration));
+    // Bias corrections are folded into the step size and the scale of r
+    Tensor::value_type stepSize = learningRate / (1.0f - pow(rho1, iteration));
+    Tensor::value_type rCorrection = 1.0f / (1.0f - pow(rho2, iteration));
 
-            Tensor::value_type paramDelta = -(learningRate * biasCorrectedS) / (delta + sqrt(biasCorrectedR));
-
-            param[j] += paramDelta;
-
-            paramGrad[j] = 0.0f;
-        }
-    }
+    forEachChunk([&](size_t _i, size_t _begin, size_t _end)
+    {
+        adamStep((*params)[_i]->data() + _begin, (*paramsGrad)[_i]->data() + _begin, s[_i].data() + _begin, r[_i].data() + _begin, _end - _begin,
+                 _gradScale, stepSize, rho1, rho2, rCorrection, delta);
+    });
 }
 #endif // USE_OPENCL
 
@@ -1,5 +1,7 @@
 #include "RNA/Optimizers/SGD.h"
+#include "RNA/ThreadPool.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace rna
@@ -10,39 +12,70 @@ Optimizer::Optimizer(std::vector<Tensor*>& _params, std::vector<Tensor*>& _param
 { }
 
 #ifdef USE_OPENCL
-void Optimizer::openCL(cl::Context& _context)
+void Optimizer::updateParams(cl::CommandQueue& _commandQueue, size_t _batchSize)
 {
-    auto& p = _context.getProgram("Kernels/maths.cl");
-    averageKernel.create(p, "mul");
+    updateParams(_commandQueue, Tensor::value_type(1.0 / _batchSize));
 }
 
-void Optimizer::updateParams(cl::CommandQueue& _commandQueue, size_t _batchSize)
+void Optimizer::enqueueUpdate(cl::CommandQueue& _commandQueue, unsigned _firstSlot, const std::vector<std::vector<Tensor>*>& _states)
 {
-//    Tensor::value_type averageFactor = 1.0 / _batchSize;
-//
-//    for (Tensor* paramGrad: *paramsGrad)
-//    {
-//        averageKernel.setArg(0, *paramGrad);
-//        averageKernel.setArg(1, averageFactor);
-//        averageKernel.setArg(2, paramGrad->getStride(0));
-//
-//        _commandQueue.enqueueKernel(averageKernel, {paramGrad->size(0)});
-//    }
-//
-//    _commandQueue.enqueueBarrier();
-
-    updateParams(_commandQueue);
+    const unsigned slotSize = 3 + _states.size();
+
+    for (size_t first(0) ; first < params->size() ; first += TENSORS_PER_LAUNCH)
+    {
+        size_t last = std::min(first + TENSORS_PER_LAUNCH, params->size()) - 1;
+        int end = 0;
+
+        // Unused slots repeat the last tensor with an empty range
+        for (size_t slot(0) ; slot < TENSORS_PER_LAUNCH ; slot++)
+        {
+            size_t i = std::min(first + slot, last);
+            unsigned arg = _firstSlot + slot * slotSize;
+
+            updateKernel.setArg(arg++, *(*params)[i]);
+            updateKernel.setArg(arg++, *(*paramsGrad)[i]);
+            for (std::vector<Tensor>* state: _states)
+                updateKernel.setArg(arg++, (*state)[i]);
+
+            if (first + slot <= last)
+                end += (*params)[i]->nElements();
+            updateKernel.setArg(arg, end);
+        }
+
+        if (end)
+            _commandQueue.enqueueKernel(updateKernel, { (size_t)end });
+    }
 }
 
 #else
+static const size_t CHUNK_SIZE = 1 << 14;
+
 void Optimizer::updateParams(size_t _batchSize)
 {
-    Tensor::value_type averageFactor = 1.0 / _batchSize;
+    updateParams(Tensor::value_type(1.0 / _batchSize));
+}
+
+void Optimizer::forEachChunk(const std::function<void(size_t, size_t, size_t)>& _step) const
+{
+    struct Chunk
+    {
+        size_t param, begin, end;
+    };
+
+    std::vector<Chunk> chunks;
+    for (size_t i(0) ; i < params->size() ; i++)
+    {
+        size_t n = (*params)[i]->nElements();
 
-    for (Tensor* paramGrad: *paramsGrad)
-        *paramGrad *= averageFactor;
+        for (size_t begin(0) ; begin < n ; begin += CHUNK_SIZE)
+            chunks.push_back({i, begin, std::min(begin + CHUNK_SIZE, n)});
+    }
 
-    updateParams();
+    ThreadPool::global().run(chunks.size(), [&](size_t _chunk)
+    {
+        const Chunk& chunk = chunks[_chunk];
+        _step(chunk.param, chunk.begin, chunk.end);
+    });
 }
 #endif // USE_OPENCL
 
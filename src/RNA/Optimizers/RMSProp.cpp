@@ -1,4 +1,6 @@
 #include "RNA/Optimizers/RMSProp.h"
+#include "RNA/Maths/optimizers.h"
+#include "RNA/kernels.h"
 
 #include <cmath>
 
@@ -17,56 +19,38 @@ RMSProp::RMSProp(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGra
 }
 
 #ifdef USE_OPENCL
-void RMSProp::updateParams(cl::CommandQueue& _commandQueue)
+void RMSProp::updateParams(cl::CommandQueue& _commandQueue, Tensor::value_type _gradScale)
 {
 //    learningRate *= (1.0 / (1.0 + learningRateDecay * ++iteration));
-//    updateKernel.setArg(3, learningRate);
+//    updateKernel.setArg(1, learningRate);
 
-    for (size_t i(0); i < params->size(); i++)
-    {
-        updateKernel.setArg(0, *(*params)[i]);
-        updateKernel.setArg(1, *(*paramsGrad)[i]);
-        updateKernel.setArg(2, r[i]);
-
-        _commandQueue.enqueueKernel(updateKernel, { r[i].nElements() });
-    }
+    updateKernel.setArg(0, _gradScale);
+    enqueueUpdate(_commandQueue, 4, { &r });
 }
 
 void RMSProp::openCL(cl::Context& _context)
 {
-    Optimizer::openCL(_context);
-
-    auto& p = _context.getProgram("Kernels/rmsprop.cl");
-    updateKernel.create(p, "updateParam");
+    auto& p = getProgram(_context, "rmsprop.cl");
+    updateKernel.create(p, "updateParams");
 
-    updateKernel.setArg(3, learningRate);
-    updateKernel.setArg(4, rho);
-    updateKernel.setArg(5, delta);
+    updateKernel.setArg(1, learningRate);
+    updateKernel.setArg(2, rho);
+    updateKernel.setArg(3, delta);
 
     for (size_t i(0); i < r.size(); i++)
         r[i].openCL(_context);
 }
 
 #else
-void RMSProp::updateParams()
+void RMSProp::updateParams(Tensor::value_type _gradScale)
 {
 //    learningRate *= (1.0 / (1.0 + learningRateDecay * ++iteration));
 
-    for (size_t i(0); i < params->size(); i++)
+    forEachChunk([&](size_t _i, size_t _begin, size_t _end)
     {
-        Tensor& param = *(*params)[i];
-        Tensor& paramGrad = *(*paramsGrad)[i];
-
-        for (unsigned j(0); j < param.nElements(); j++)
-        {
-            r[i][j] = rho * r[i][j] + (1.0f-rho) * paramGrad[j]*paramGrad[j];
-
-            Tensor::value_type paramDelta = -(learningRate * paramGrad[j]) / sqrt(delta+r[i][j]);
-            param[j] += paramDelta;
-
-            paramGrad[j] = 0.0f;
-        }
-    }
+        rmspropStep((*params)[_i]->data() + _begin, (*paramsGrad)[_i]->data() + _begin, r[_i].data() + _begin, _end - _begin,
+                    _gradScale, learningRate, rho, delta);
+    });
 }
 #endif // USE_OPENCL
 
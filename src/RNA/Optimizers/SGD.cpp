@@ -1,4 +1,6 @@
 #include "RNA/Optimizers/SGD.h"
+#include "RNA/Maths/optimizers.h"
+#include "RNA/kernels.h"
 
 namespace rna
 {
@@ -15,45 +17,32 @@ SGD::SGD(std::vector<Tensor*>& _params, std::vector<Tensor*>& _paramsGrad, Tenso
 
 
 #ifdef USE_OPENCL
-void SGD::updateParams(cl::CommandQueue& _commandQueue)
+void SGD::updateParams(cl::CommandQueue& _commandQueue, Tensor::value_type _gradScale)
 {
-    for (size_t i(0); i < params->size(); i++)
-    {
-        updateKernel.setArg(0, *(*params)[i]);
-        updateKernel.setArg(1, *(*paramsGrad)[i]);
-        updateKernel.setArg(2, paramsDelta[i]);
-
-        _commandQueue.enqueueKernel(updateKernel, { paramsDelta[i].nElements() });
-    }
+    updateKernel.setArg(0, _gradScale);
+    enqueueUpdate(_commandQueue, 3, { &paramsDelta });
 }
 
 void SGD::openCL(cl::Context& _context)
 {
-    Optimizer::openCL(_context);
-
-    auto& p = _context.getProgram("Kernels/sgd.cl");
-    updateKernel.create(p, "updateParam");
+    auto& p = getProgram(_context, "sgd.cl");
+    updateKernel.create(p, "updateParams");
 
-    updateKernel.setArg(3, learningRate);
-    updateKernel.setArg(4, inertia);
+    updateKernel.setArg(1, learningRate);
+    updateKernel.setArg(2, inertia);
 
     for (size_t i(0); i < paramsDelta.size(); i++)
         paramsDelta[i].openCL(_context);
 }
 
 #else
-void SGD::updateParams()
+void SGD::updateParams(Tensor::value_type _gradScale)
 {
-    for (size_t i(0); i < params->size(); i++)
+    forEachChunk([&](size_t _i, size_t _begin, size_t _end)
     {
-        Tensor& param = *(*params)[i];
-        Tensor& paramGrad = *(*paramsGrad)[i];
-
-        paramsDelta[i] = inertia * paramsDelta[i] - 0.01f * learningRate * paramGrad;
-        param += paramsDelta[i];
-
-        paramGrad.fill(0.0f);
-    }
+        sgdStep((*params)[_i]->data() + _begin, (*paramsGrad)[_i]->data() + _begin, paramsDelta[_i].data() + _begin, _end - _begin,
+                _gradScale, learningRate, inertia);
+    });
 }
 #endif // USE_OPENCL
 
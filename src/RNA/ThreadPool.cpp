@@ -0,0 +1,140 @@
+#include "RNA/ThreadPool.h"
+
+#include <algorithm>
+
+namespace rna
+{
+
+namespace
+{
+
+// Set while a thread executes tasks, so that nested calls do not wait on the pool
+thread_local bool insideTask = false;
+
+}
+
+ThreadPool::ThreadPool(size_t _threads):
+    task(nullptr), taskCount(0), nextTask(0),
+    activeWorkers(0), generation(0), quit(false)
+{
+    start(_threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::resize(size_t _threads)
+{
+    std::lock_guard<std::mutex> serial(runMutex);
+
+    stop();
+    start(_threads);
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::run(size_t _tasks, const std::function<void(size_t)>& _task)
+{
+    if (workers.empty() || _tasks < 2 || insideTask)
+    {
+        for (size_t i(0) ; i < _tasks ; i++)
+            _task(i);
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> serial(runMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        task = &_task;
+        taskCount = _tasks;
+        nextTask = 0;
+
+        activeWorkers = workers.size();
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    execute();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]() { return activeWorkers == 0; });
+
+    task = nullptr;
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+
+    return pool;
+}
+
+void ThreadPool::start(size_t _threads)
+{
+    if (_threads == 0)
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+
+    quit = false;
+
+    // The thread calling run is the last worker
+    for (size_t i(1) ; i < _threads ; i++)
+        workers.emplace_back(&ThreadPool::work, this, generation);
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeUp.notify_all();
+
+    for (std::thread& worker: workers)
+        worker.join();
+
+    workers.clear();
+}
+
+void ThreadPool::work(size_t _generation)
+{
+    size_t seenGeneration = _generation;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&]() { return quit || generation != seenGeneration; });
+
+            if (quit)
+                return;
+
+            seenGeneration = generation;
+        }
+
+        execute();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0)
+            finished.notify_one();
+    }
+}
+
+void ThreadPool::execute()
+{
+    insideTask = true;
+
+    for (size_t i = nextTask++ ; i < taskCount ; i = nextTask++)
+        (*task)(i);
+
+    insideTask = false;
+}
+
+}
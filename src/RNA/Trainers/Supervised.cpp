@@ -1,10 +1,13 @@
 #include "RNA/Trainers/Supervised.h"
+#include "RNA/ThreadPool.h"
 
 #include "Utility/Error.h"
 #include "Utility/Random.h"
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
+#include <string>
 
 #include "windows.h"
 
@@ -55,6 +58,10 @@ Supervised::Supervised(rna::Network& _network):
 
 Supervised::~Supervised()
 {
+    #ifndef USE_OPENCL
+    releaseReplicas();
+    #endif // USE_OPENCL
+
     delete loss;
     delete optimizer;
 }
@@ -305,8 +312,109 @@ void Supervised::earlyStopping_generator(Generator _training, size_t _trainSteps
 }
 
 #else
+namespace
+{
+
+const size_t SYNC_CHUNK_SIZE = 1 << 14;
+
+// Copies rows [_begin, _end) of a batch
+void copyRows(Tensor& _dst, const Tensor& _src, size_t _begin, size_t _end)
+{
+    size_t rowSize = _src.nElements() / _src.size(0);
+
+    coords_t size = _src.size();
+    size[0] = _end - _begin;
+
+    _dst.resize(size);
+    std::copy(_src.data() + _begin*rowSize, _src.data() + _end*rowSize, _dst.data());
+}
+
+}
+
+size_t Supervised::createReplicas(size_t _workers)
+{
+    releaseReplicas();
+
+    replicas.push_back(Replica{network, loss, params, paramsGrad, Example()});
+
+    if (!lossFactory)
+        return 1;
+
+    while (replicas.size() < _workers)
+    {
+        Network* copy = network->clone();
+        if (!copy)
+            break;
+
+        // Nothing reads the input gradients of a replica
+        copy->setGradientSharing(true);
+
+        replicas.push_back(Replica{copy, lossFactory(), {}, {}, Example()});
+        copy->getParams(replicas.back().params, replicas.back().paramsGrad);
+    }
+
+    return std::min(_workers, replicas.size());
+}
+
+void Supervised::releaseReplicas()
+{
+    for (size_t w(1) ; w < replicas.size() ; w++)
+    {
+        delete replicas[w].network;
+        delete replicas[w].loss;
+    }
+
+    replicas.clear();
+}
+
+void Supervised::syncReplicas()
+{
+    if (replicas.size() < 2)
+        return;
+
+    struct Chunk
+    {
+        size_t param, begin, end;
+    };
+
+    std::vector<Chunk> chunks;
+    for (size_t k(0) ; k < params.size() ; k++)
+    {
+        size_t n = params[k]->nElements();
+
+        for (size_t begin(0) ; begin < n ; begin += SYNC_CHUNK_SIZE)
+            chunks.push_back({k, begin, std::min(begin + SYNC_CHUNK_SIZE, n)});
+    }
+
+    ThreadPool::global().run(chunks.size(), [&](size_t _chunk)
+    {
+        const Chunk& chunk = chunks[_chunk];
+        const Tensor::value_type* src = params[chunk.param]->data();
+
+        for (size_t w(1) ; w < replicas.size() ; w++)
+            std::copy(src + chunk.begin, src + chunk.end, replicas[w].params[chunk.param]->data() + chunk.begin);
+    });
+}
+
 void Supervised::train(const DataSet& _dataSet, size_t _steps, size_t _batchSize)
 {
+    if (_batchSize == 0 || _dataSet.size() < _batchSize)
+    {
+        Error::add(ErrorType::USER_ERROR, "Supervised::train => The data set must hold at least one batch of " + std::to_string(_batchSize) + " examples");
+        return;
+    }
+
+    DataSet dataSet;
+    buildBatches(_dataSet, dataSet, _batchSize);
+
+    ThreadPool& pool = ThreadPool::global();
+
+    // The first worker trains the network itself, the others train fresh clones of it with their own buffers
+    size_t workers = createReplicas(std::min(pool.size(), _batchSize));
+
+    for (size_t w(0) ; w < workers ; w++)
+        replicas[w].network->setBatchMode(true);
+
     auto debut = GetTickCount();
 
     for (size_t step(0); step < _steps; ++step)
@@ -314,21 +422,63 @@ void Supervised::train(const DataSet& _dataSet, size_t _steps, size_t _batchSize
         if (step % (_steps / 10) == 0)
             std::cout << "Step: " << step << std::endl;
 
-        for (size_t i(0); i < _batchSize; i++)
+        const Example& batch = Random::element(dataSet);
+
+        if (workers == 1)
+        {
+            const Tensor& output = network->feedForward(batch.input);
+            const Tensor& gradient = loss->getGradient(output, batch.output);
+
+            network->backprop(batch.input, gradient);
+            optimizer->updateParams(_batchSize);
+
+            continue;
+        }
+
+        pool.run(workers, [&](size_t w)
+        {
+            Replica& replica = replicas[w];
+
+            size_t begin = _batchSize * w / workers, end = _batchSize * (w+1) / workers;
+
+            copyRows(replica.shard.input, batch.input, begin, end);
+            copyRows(replica.shard.output, batch.output, begin, end);
+
+            const Tensor& output = replica.network->feedForward(replica.shard.input);
+            const Tensor& gradient = replica.loss->getGradient(output, replica.shard.output);
+
+            replica.network->backprop(replica.shard.input, gradient);
+        });
+
+        // Tree reduction into the gradients of the network, in a fixed order so that results do not depend on scheduling
+        for (size_t stride(1) ; stride < workers ; stride *= 2)
         {
-            const Example& example = Random::element(_dataSet);
+            pool.run((workers + 2*stride - 1) / (2*stride), [&](size_t i)
+            {
+                Replica& dst = replicas[2*stride*i];
 
-            const Tensor& output = network->feedForward(example.input);
-            const Tensor& gradient = loss->getGradient(output, example.output);
+                if (2*stride*i + stride >= workers)
+                    return;
 
-            network->backprop(example.input, gradient);
+                Replica& src = replicas[2*stride*i + stride];
+
+                for (size_t k(0) ; k < dst.paramsGrad.size() ; k++)
+                {
+                    *dst.paramsGrad[k] += *src.paramsGrad[k];
+                    src.paramsGrad[k]->fill(0.0f);
+                }
+            });
         }
 
         optimizer->updateParams(_batchSize);
+        syncReplicas();
     }
 
     auto time = GetTickCount()-debut;
     std::cout << "Temps: " << (time>1000?time/1000.0f:time) << (time>1000?" s":" ms") << std::endl;
+
+    network->setBatchMode(false);
+    releaseReplicas();
 }
 #endif // USE_OPENCL
 
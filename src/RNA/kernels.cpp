@@ -0,0 +1,268 @@
+#include "RNA/kernels.h"
+
+#ifdef USE_OPENCL
+#include "Utility/Error.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace rna
+{
+
+namespace
+{
+
+struct KernelSource
+{
+    const char* file;
+    const char* source;
+};
+
+// Generated from Kernels/*.cl by Kernels/embed.sh
+const KernelSource kernelSources[] =
+{
+    #include "kernelSources.inc"
+};
+
+/// FNV-1a
+uint64_t hash(const std::string& _data)
+{
+    uint64_t h = 14695981039346656037ull;
+
+    for (unsigned char c: _data)
+        h = (h ^ c) * 1099511628211ull;
+
+    return h;
+}
+
+std::string hex(uint64_t _value)
+{
+    std::ostringstream text;
+    text << std::hex << _value;
+
+    return text.str();
+}
+
+/// Whether _directory exists, creating it if needed, and nobody but the current user can write to it
+bool privateDirectory(const std::string& _directory)
+{
+    #ifdef _WIN32
+    CreateDirectoryA(_directory.c_str(), nullptr);
+
+    DWORD attributes = GetFileAttributesA(_directory.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+    #else
+    // The parent of the default directory may not exist yet either
+    mkdir(_directory.substr(0, _directory.rfind('/')).c_str(), 0700);
+    mkdir(_directory.c_str(), 0700);
+
+    struct stat status;
+    return !stat(_directory.c_str(), &status) && S_ISDIR(status.st_mode) && status.st_uid == geteuid() && !(status.st_mode & (S_IWGRP | S_IWOTH));
+    #endif // _WIN32
+}
+
+/// RNA_KERNEL_CACHE, else RNA in the per-user cache directory of the platform, else a new directory in the temporary one
+/// Empty when none can be used: anyone else able to write there could swap the sources between their check and their build
+std::string kernelDirectory()
+{
+    std::string directory;
+
+    // Set but empty counts as unset
+    if (const char* path = std::getenv("RNA_KERNEL_CACHE"))
+        directory = path;
+
+    if (directory.empty())
+    {
+        #ifdef _WIN32
+        const char* root = std::getenv("LOCALAPPDATA");
+
+        if (root && *root)
+            directory = std::string(root) + "/RNA";
+        #else
+        const char* root = std::getenv("XDG_CACHE_HOME");
+        const char* home = std::getenv("HOME");
+
+        if (root && *root)
+            directory = std::string(root) + "/RNA";
+        else if (home && *home)
+            directory = std::string(home) + "/.cache/RNA";
+        #endif // _WIN32
+    }
+
+    if (!directory.empty())
+    {
+        if (privateDirectory(directory))
+            return directory;
+
+        Error::add(ErrorType::USER_ERROR, "getProgram => Not a private directory, using a temporary one for the kernels: " + directory);
+    }
+
+    #ifdef _WIN32
+    char root[MAX_PATH + 1];
+    DWORD size = GetTempPathA(sizeof(root), root);
+    if (!size || size > MAX_PATH)
+        return "";
+
+    directory = std::string(root) + "RNA";
+    if (privateDirectory(directory))
+        return directory;
+    #else
+    const char* root = std::getenv("TMPDIR");
+    directory = std::string(root && *root? root: "/tmp") + "/RNA-XXXXXX";
+
+    // Created with mode 0700, under a name nobody else has
+    if (mkdtemp(&directory[0]))
+        return directory;
+    #endif // _WIN32
+
+    Error::add(ErrorType::USER_ERROR, "getProgram => Unable to create a directory for the kernels: " + directory);
+    return "";
+}
+
+/// Whether _path holds exactly _source
+bool holds(const std::string& _path, const std::string& _source)
+{
+    std::ifstream file(_path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream content;
+    content << file.rdbuf();
+
+    return content.str() == _source;
+}
+
+bool writeAll(int _file, const std::string& _data)
+{
+    for (size_t written(0) ; written < _data.size() ; )
+    {
+        #ifdef _WIN32
+        int n = _write(_file, _data.data() + written, unsigned(_data.size() - written));
+        #else
+        ssize_t n = write(_file, _data.data() + written, _data.size() - written);
+        #endif // _WIN32
+
+        if (n <= 0)
+            return false;
+
+        written += n;
+    }
+
+    return true;
+}
+
+/// The file is written under a unique temporary name then renamed, so readers never see it partially written
+/// and concurrent writers never share a file
+bool writeSource(const std::string& _path, const std::string& _source)
+{
+    #ifdef _WIN32
+    std::string temporary;
+    int file = -1;
+    for (unsigned attempt(0) ; file < 0 && attempt < 16 ; attempt++)
+    {
+        temporary = _path + "." + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(GetTickCount()) + "-" + std::to_string(attempt);
+        file = _open(temporary.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    #else
+    std::string temporary = _path + ".XXXXXX";
+    int file = mkstemp(&temporary[0]);
+    #endif // _WIN32
+
+    if (file < 0)
+        return false;
+
+    bool written = writeAll(file, _source);
+
+    #ifdef _WIN32
+    written &= !_close(file);
+    written = written && MoveFileExA(temporary.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING);
+    #else
+    written &= !close(file);
+    written = written && !std::rename(temporary.c_str(), _path.c_str());
+    #endif // _WIN32
+
+    if (!written)
+        std::remove(temporary.c_str());
+
+    return written;
+}
+
+/// Absolute path of a file holding the embedded source of _file, empty on failure
+std::string sourcePath(const std::string& _file)
+{
+    // Looked up once: the directory is created and checked on the first call
+    static const std::string directory = kernelDirectory();
+
+    for (const KernelSource& kernel: kernelSources)
+    {
+        if (_file != kernel.file)
+            continue;
+
+        if (directory.empty())
+        {
+            Error::add(ErrorType::USER_ERROR, "getProgram => No directory to write kernel source: " + _file);
+            return "";
+        }
+
+        const std::string source = kernel.source;
+        const std::string stem = _file.substr(0, _file.rfind('.'));
+        const std::string path = directory + "/" + stem + "-" + hex(hash(source)) + ".cl";
+
+        // Rewritten when missing, or when it does not hold the source its name promises
+        if (!holds(path, source) && !writeSource(path, source))
+        {
+            Error::add(ErrorType::USER_ERROR, "getProgram => Unable to write kernel source: " + path);
+            return "";
+        }
+
+        return path;
+    }
+
+    Error::add(ErrorType::USER_ERROR, "getProgram => Kernel is not embedded: " + _file);
+    return "";
+}
+
+}
+
+cl::Program& getProgram(cl::Context& _context, const std::string& _file)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::string> paths;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto path = paths.find(_file);
+    if (path == paths.end())
+    {
+        std::string found = sourcePath(_file);
+
+        // Failures are not remembered, so they are reported again
+        // The context then fails on an empty path instead of looking in the working directory
+        if (found.empty())
+            return _context.getProgram(found);
+
+        path = paths.emplace(_file, found).first;
+    }
+
+    return _context.getProgram(path->second);
+}
+
+}
+#endif // USE_OPENCL
@@ -20,10 +20,9 @@ void test()
 
     ann.add( new rna::Reshape({28*28}) );
     ann.add( new rna::Linear(28*28, 10) );
-    ann.add( new rna::LogSoftMax() );
 
     rna::Supervised trainer(ann);
-        trainer.setLoss<rna::NLL>();
+        trainer.setLoss<rna::CrossEntropy>();
         trainer.setOptimizer<rna::SGD>(0.5f);
 
     trainer.train(training, 1000, 100);
@@ -45,10 +44,9 @@ void test()
 
     ann.add( new rna::Reshape({28*28}) );
     ann.add( new rna::Linear(28*28, 10) );
-    ann.add( new rna::LogSoftMax() );
 
     rna::Supervised trainer(ann);
-        trainer.setLoss<rna::NLL>();
+        trainer.setLoss<rna::CrossEntropy>();
         trainer.setOptimizer<rna::SGD>(0.5f);
 
     trainer.train(training, 1000, 100);
@@ -0,0 +1,173 @@
+#pragma once
+
+/// Host emulation of the subset of OpenCL C used by Kernels/*.cl, to check the kernels without a device
+/// emulate.sh rewrites the kernel files into C++ (vector literals and __local declarations), then they are included in a namespace
+/// The work-items of a work-group run as threads, so barriers and local memory behave as on a device
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define __kernel
+#define __global
+#define __constant
+
+typedef unsigned int uint;
+
+struct float4
+{
+    float4() {}
+    float4(float _v): x(_v), y(_v), z(_v), w(_v) {}
+    float4(float _x, float _y, float _z, float _w): x(_x), y(_y), z(_z), w(_w) {}
+
+    float x, y, z, w;
+};
+
+inline float4 make_float4(float _v) { return float4(_v); }
+inline float4 make_float4(float _x, float _y, float _z, float _w) { return float4(_x, _y, _z, _w); }
+
+inline float4 operator+(float4 _a, float4 _b) { return float4(_a.x+_b.x, _a.y+_b.y, _a.z+_b.z, _a.w+_b.w); }
+inline float4 operator-(float4 _a, float4 _b) { return float4(_a.x-_b.x, _a.y-_b.y, _a.z-_b.z, _a.w-_b.w); }
+inline float4 operator*(float4 _a, float4 _b) { return float4(_a.x*_b.x, _a.y*_b.y, _a.z*_b.z, _a.w*_b.w); }
+inline float4 operator*(float _a, float4 _b) { return float4(_a) * _b; }
+inline float4 operator*(float4 _a, float _b) { return _a * float4(_b); }
+inline float4& operator+=(float4& _a, float4 _b) { return _a = _a + _b; }
+inline float4& operator-=(float4& _a, float4 _b) { return _a = _a - _b; }
+inline float4& operator*=(float4& _a, float4 _b) { return _a = _a * _b; }
+
+inline float dot(float4 _a, float4 _b) { return _a.x*_b.x + _a.y*_b.y + _a.z*_b.z + _a.w*_b.w; }
+inline float4 vload4(size_t _offset, const float* _p) { _p += 4*_offset; return float4(_p[0], _p[1], _p[2], _p[3]); }
+inline void vstore4(float4 _v, size_t _offset, float* _p) { _p += 4*_offset; _p[0] = _v.x; _p[1] = _v.y; _p[2] = _v.z; _p[3] = _v.w; }
+
+template<typename T> T min(T _a, T _b) { return _a < _b? _a: _b; }
+template<typename T> T max(T _a, T _b) { return _a > _b? _a: _b; }
+inline float clamp(float _x, float _min, float _max) { return std::min(std::max(_x, _min), _max); }
+inline uint mul_hi(uint _a, uint _b) { return uint((uint64_t(_a) * _b) >> 32); }
+inline float mad(float _a, float _b, float _c) { return _a*_b + _c; }
+inline float rsqrt(float _x) { return 1.0f / std::sqrt(_x); }
+inline float native_exp(float _x) { return std::exp(_x); }
+inline float native_recip(float _x) { return 1.0f / _x; }
+inline float native_divide(float _x, float _y) { return _x / _y; }
+
+using std::exp;
+using std::sqrt;
+using std::tanh;
+
+namespace emu
+{
+
+struct WorkGroup
+{
+    size_t size;
+    size_t waiting = 0, generation = 0;
+
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+struct WorkItem
+{
+    size_t global[3], local[3], group[3];
+    WorkGroup* workGroup;
+};
+
+extern thread_local WorkItem item;
+extern size_t globalSize[3], localSize[3];
+
+/// Runs _kernel over _global work-items in work-groups of _local (both padded to 3 dimensions with 1)
+/// _global must be a multiple of _local, as on a device
+void run(std::vector<size_t> _global, std::vector<size_t> _local, const std::function<void()>& _kernel);
+
+}
+
+inline size_t get_global_id(uint _d) { return emu::item.global[_d]; }
+inline size_t get_local_id(uint _d) { return emu::item.local[_d]; }
+inline size_t get_group_id(uint _d) { return emu::item.group[_d]; }
+inline size_t get_global_size(uint _d) { return emu::globalSize[_d]; }
+inline size_t get_local_size(uint _d) { return emu::localSize[_d]; }
+
+enum { CLK_LOCAL_MEM_FENCE = 1, CLK_GLOBAL_MEM_FENCE = 2 };
+
+inline void barrier(int)
+{
+    emu::WorkGroup& group = *emu::item.workGroup;
+    std::unique_lock<std::mutex> lock(group.mutex);
+
+    size_t generation = group.generation;
+    if (++group.waiting == group.size)
+    {
+        group.waiting = 0;
+        group.generation++;
+        group.released.notify_all();
+    }
+    else
+        group.released.wait(lock, [&]{ return group.generation != generation; });
+}
+
+/// The whole emulation is in a single translation unit: test/unit/kernels.cpp defines it
+#ifdef CLEMU_IMPLEMENTATION
+namespace emu
+{
+
+thread_local WorkItem item;
+size_t globalSize[3], localSize[3];
+
+void run(std::vector<size_t> _global, std::vector<size_t> _local, const std::function<void()>& _kernel)
+{
+    _global.resize(3, 1);
+    _local.resize(3, 1);
+
+    std::copy(_global.begin(), _global.end(), globalSize);
+    std::copy(_local.begin(), _local.end(), localSize);
+
+    size_t groups[3] = {_global[0] / _local[0], _global[1] / _local[1], _global[2] / _local[2]};
+    size_t groupSize = _local[0] * _local[1] * _local[2];
+
+    for (size_t g2(0) ; g2 < groups[2] ; g2++)
+    for (size_t g1(0) ; g1 < groups[1] ; g1++)
+    for (size_t g0(0) ; g0 < groups[0] ; g0++)
+    {
+        WorkGroup workGroup;
+        workGroup.size = groupSize;
+
+        auto runItem = [&](size_t _index)
+        {
+            size_t l[3] = {_index % _local[0], _index / _local[0] % _local[1], _index / (_local[0]*_local[1])};
+            size_t g[3] = {g0, g1, g2};
+
+            for (size_t d(0) ; d < 3 ; d++)
+            {
+                item.local[d] = l[d];
+                item.group[d] = g[d];
+                item.global[d] = g[d]*_local[d] + l[d];
+            }
+            item.workGroup = &workGroup;
+
+            _kernel();
+        };
+
+        // Kernels without local memory run with work-groups of 1, on the calling thread
+        if (groupSize == 1)
+        {
+            runItem(0);
+            continue;
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i(0) ; i < groupSize ; i++)
+            threads.emplace_back(runItem, i);
+
+        for (std::thread& thread: threads)
+            thread.join();
+    }
+}
+
+}
+#endif // CLEMU_IMPLEMENTATION
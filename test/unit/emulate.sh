@@ -0,0 +1,24 @@
+#!/bin/sh
+# emulate.sh Kernels test/unit/emulated : rewrites every kernel of a directory into C++ for the emulation of test/unit/clemu.h
+# Vector literals become calls, __local arrays are shared by the threads of a work-group and other __local qualifiers are dropped
+
+mkdir -p "$2"
+
+for file in "$1"/*.cl
+do
+    out="$2/$(basename "$file" .cl).h"
+
+    sed -e 's/\r$//' \
+        -e 's/(float4)(/make_float4(/g' \
+        -e 's/__local \(float [A-Za-z_][A-Za-z_0-9]*\[\)/static \1/g' \
+        -e 's/__local //g' \
+        "$file" > "$out.tmp"
+
+    # Keep the previous file when nothing changed so that the tests are not rebuilt
+    if cmp -s "$out.tmp" "$out"
+    then
+        rm "$out.tmp"
+    else
+        mv "$out.tmp" "$out"
+    fi
+done
@@ -0,0 +1,730 @@
+#include "unit.h"
+
+#include "RNA/Layers/Dropout.h"
+
+#define CLEMU_IMPLEMENTATION
+#include "clemu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Generated from Kernels/*.cl by emulate.sh before the build
+namespace linear
+{
+#include "emulated/linear.h"
+}
+
+#undef TILE_FLOATS
+
+// Small local memory: many slices per reduction, and direct reads for the widest work-groups
+namespace linearSmallTiles
+{
+#define TILE_FLOATS 32
+#include "emulated/linear.h"
+}
+
+#undef TILE_FLOATS
+
+namespace convolutional
+{
+#include "emulated/convolutional.h"
+}
+
+namespace maxPooling
+{
+#include "emulated/maxPooling.h"
+}
+
+namespace adam
+{
+#include "emulated/adam.h"
+}
+
+// The optimizer kernels all define these helpers
+#undef TENSOR
+#undef STEP
+
+namespace sgd
+{
+#include "emulated/sgd.h"
+}
+
+#undef TENSOR
+#undef STEP
+
+namespace rmsprop
+{
+#include "emulated/rmsprop.h"
+}
+
+#undef TENSOR
+#undef STEP
+
+namespace losses
+{
+#include "emulated/losses.h"
+}
+
+namespace dropout
+{
+#include "emulated/dropout.h"
+}
+
+namespace Unit
+{
+
+namespace
+{
+
+size_t roundUp(size_t _size, size_t _multiple)
+{
+    return (_size + _multiple - 1) / _multiple * _multiple;
+}
+
+double maxError(const std::vector<float>& _values, const std::vector<double>& _reference)
+{
+    double error = 0.0;
+    // NaN propagates, so that overflows fail the check
+    for (size_t i(0) ; i < _values.size() ; i++)
+        if (!(std::abs(_values[i] - _reference[i]) <= error))
+            error = std::abs(_values[i] - _reference[i]);
+
+    return error;
+}
+
+double activate(double _x, int _activation, double _alpha)
+{
+    switch (_activation)
+    {
+        case 1: return std::tanh(_x);
+        case 2: return 1.0 / (1.0 + std::exp(-_x));
+        case 3: return std::max(_x, 0.0);
+        case 4: return _x < 0.0? _alpha * (std::exp(_x) - 1.0): _x;
+        default: return _x;
+    }
+}
+
+}
+
+bool linearKernels()
+{
+    bool passed = true;
+
+    // batchSize, inputWidth, outputWidth: edges in every dimension, and reductions spanning several slices
+    const int shapes[][3] = {{1, 5, 3}, {3, 2, 1}, {7, 13, 9}, {16, 64, 32}, {9, 30, 17}, {37, 70, 10}};
+
+    // The runtime picks the work-groups: square, tall, flat and single work-item shapes
+    const size_t locals[][2] = {{1, 1}, {16, 4}, {8, 8}, {4, 16}, {32, 1}, {3, 2}};
+
+    for (bool smallTiles: {false, true})
+    {
+        auto feedForward = smallTiles? linearSmallTiles::feedForwardLinear: linear::feedForwardLinear;
+        auto backprop = smallTiles? linearSmallTiles::backpropLinear: linear::backpropLinear;
+        auto weightsGrad = smallTiles? linearSmallTiles::weightsGradLinear: linear::weightsGradLinear;
+
+        for (const auto& l: locals)
+        {
+            for (const auto& s: shapes)
+            {
+                int batchSize = s[0], inputWidth = s[1], outputWidth = s[2];
+                const float alpha = 0.7f;
+
+                std::vector<float> input(batchSize * inputWidth), weights(outputWidth * inputWidth), bias(outputWidth);
+                std::vector<float> outputGrad(batchSize * outputWidth), paramsGrad(outputWidth * inputWidth);
+                randomize(input.data(), input.size());
+                randomize(weights.data(), weights.size());
+                randomize(bias.data(), bias.size());
+                randomize(outputGrad.data(), outputGrad.size());
+                randomize(paramsGrad.data(), paramsGrad.size());
+
+                std::string shape = std::to_string(batchSize) + "x" + std::to_string(inputWidth) + "x" + std::to_string(outputWidth)
+                                  + " local " + std::to_string(l[0]) + "x" + std::to_string(l[1]) + (smallTiles? " small tiles": "");
+
+                // Global sizes rounded up to the work-group, the work-items past the edges only help staging
+                auto global = [&](size_t _rows, size_t _columns) { return std::vector<size_t>{roundUp(_rows, l[0]), roundUp((_columns+3) / 4, l[1])}; };
+
+                for (int activation(0) ; activation < 5 ; activation++)
+                {
+                    std::vector<float> output(batchSize * outputWidth);
+
+                    emu::run(global(batchSize, outputWidth), {l[0], l[1]}, [&]
+                    {
+                        feedForward(output.data(), input.data(), weights.data(), bias.data(), batchSize, inputWidth, outputWidth, activation, alpha);
+                    });
+
+                    double error = 0.0;
+                    for (int n(0) ; n < batchSize ; n++)
+                    {
+                        for (int o(0) ; o < outputWidth ; o++)
+                        {
+                            double sum = bias[o];
+                            for (int i(0) ; i < inputWidth ; i++)
+                                sum += double(input[n*inputWidth + i]) * weights[o*inputWidth + i];
+
+                            error = std::max(error, std::abs(output[n*outputWidth + o] - activate(sum, activation, alpha)));
+                        }
+                    }
+
+                    passed &= check(error, 0.0, 1e-5, "feedForwardLinear " + shape + " activation " + std::to_string(activation));
+                }
+
+                std::vector<float> inputGrad(batchSize * inputWidth), accumulated = paramsGrad;
+
+                emu::run(global(batchSize, inputWidth), {l[0], l[1]}, [&]
+                {
+                    backprop(inputGrad.data(), outputGrad.data(), weights.data(), batchSize, inputWidth, outputWidth);
+                });
+
+                emu::run(global(outputWidth, inputWidth), {l[0], l[1]}, [&]
+                {
+                    weightsGrad(accumulated.data(), outputGrad.data(), input.data(), batchSize, inputWidth, outputWidth);
+                });
+
+                double inputError = 0.0, weightsError = 0.0;
+                for (int i(0) ; i < inputWidth ; i++)
+                {
+                    for (int n(0) ; n < batchSize ; n++)
+                    {
+                        double sum = 0.0;
+                        for (int o(0) ; o < outputWidth ; o++)
+                            sum += double(outputGrad[n*outputWidth + o]) * weights[o*inputWidth + i];
+
+                        inputError = std::max(inputError, std::abs(inputGrad[n*inputWidth + i] - sum));
+                    }
+
+                    for (int o(0) ; o < outputWidth ; o++)
+                    {
+                        double sum = paramsGrad[o*inputWidth + i];
+                        for (int n(0) ; n < batchSize ; n++)
+                            sum += double(outputGrad[n*outputWidth + o]) * input[n*inputWidth + i];
+
+                        weightsError = std::max(weightsError, std::abs(accumulated[o*inputWidth + i] - sum));
+                    }
+                }
+
+                passed &= check(inputError, 0.0, 1e-5, "backpropLinear " + shape);
+                passed &= check(weightsError, 0.0, 1e-5, "weightsGradLinear " + shape);
+            }
+        }
+    }
+
+    return passed;
+}
+
+bool convolutionalKernels()
+{
+    bool passed = true;
+
+    // batchSize, inputChannels, outputChannels, width, height, kernelWidth, kernelHeight
+    const int shapes[][7] = {{1, 1, 1, 5, 4, 3, 3}, {3, 2, 4, 9, 8, 3, 3}, {2, 3, 2, 7, 10, 5, 2}};
+
+    for (const auto& s: shapes)
+    {
+        int batchSize = s[0], inputChannels = s[1], outputChannels = s[2], width = s[3], height = s[4], kernelWidth = s[5], kernelHeight = s[6];
+        int outputWidth = width - kernelWidth + 1, outputHeight = height - kernelHeight + 1;
+        int kernelSize = kernelWidth * kernelHeight, outputSize = outputWidth * outputHeight;
+
+        std::vector<float> input(batchSize * inputChannels * width * height), weights(outputChannels * inputChannels * kernelSize);
+        std::vector<float> bias(outputChannels * outputSize), outputGrad(batchSize * outputChannels * outputSize);
+        std::vector<float> weightsGrad(weights.size()), biasGrad(bias.size());
+        randomize(input.data(), input.size());
+        randomize(weights.data(), weights.size());
+        randomize(bias.data(), bias.size());
+        randomize(outputGrad.data(), outputGrad.size());
+        randomize(weightsGrad.data(), weightsGrad.size());
+        randomize(biasGrad.data(), biasGrad.size());
+
+        // Convolution as in the CPU layer: weight (u, v) meets pixel (x + kw-1-u, y + kh-1-v)
+        auto in = [&](int _n, int _c, int _x, int _y) -> double { return input[((_n*inputChannels + _c)*width + _x)*height + _y]; };
+        auto weight = [&](int _o, int _c, int _u, int _v) -> double { return weights[((_o*inputChannels + _c)*kernelWidth + _u)*kernelHeight + _v]; };
+
+        std::vector<double> output(outputGrad.size()), inputGrad(input.size(), 0.0), expectedWeightsGrad(weightsGrad.begin(), weightsGrad.end());
+        std::vector<double> expectedBiasGrad(biasGrad.begin(), biasGrad.end());
+
+        for (int n(0) ; n < batchSize ; n++)
+        for (int o(0) ; o < outputChannels ; o++)
+        for (int x(0) ; x < outputWidth ; x++)
+        for (int y(0) ; y < outputHeight ; y++)
+        {
+            int index = ((n*outputChannels + o)*outputWidth + x)*outputHeight + y;
+            double sum = bias[(o*outputWidth + x)*outputHeight + y];
+
+            for (int c(0) ; c < inputChannels ; c++)
+            for (int u(0) ; u < kernelWidth ; u++)
+            for (int v(0) ; v < kernelHeight ; v++)
+            {
+                int i = x + kernelWidth-1-u, j = y + kernelHeight-1-v;
+
+                sum += weight(o, c, u, v) * in(n, c, i, j);
+                inputGrad[((n*inputChannels + c)*width + i)*height + j] += weight(o, c, u, v) * outputGrad[index];
+                expectedWeightsGrad[((o*inputChannels + c)*kernelWidth + u)*kernelHeight + v] += outputGrad[index] * in(n, c, i, j);
+            }
+
+            output[index] = sum;
+            expectedBiasGrad[(o*outputWidth + x)*outputHeight + y] += outputGrad[index];
+        }
+
+        std::string shape = std::to_string(batchSize) + "x" + std::to_string(inputChannels) + "x" + std::to_string(width) + "x" + std::to_string(height)
+                          + " kernel " + std::to_string(kernelWidth) + "x" + std::to_string(kernelHeight);
+
+        // Global ranges as enqueued by Convolutional: one launch for the whole batch
+        std::vector<float> result(output.size());
+        emu::run({size_t(batchSize*outputChannels), size_t(outputWidth), size_t(outputHeight)}, {}, [&]
+        {
+            convolutional::feedForwardConvolutional(result.data(), input.data(), weights.data(), bias.data(), inputChannels, kernelWidth, kernelHeight, outputChannels);
+        });
+        passed &= check(maxError(result, output), 0.0, 1e-5, "feedForwardConvolutional " + shape);
+
+        result.assign(input.size(), 0.0f);
+        emu::run({size_t(batchSize*inputChannels), size_t(width), size_t(height)}, {}, [&]
+        {
+            convolutional::backpropConvolutional(result.data(), outputGrad.data(), weights.data(), outputChannels, kernelWidth, kernelHeight, inputChannels);
+        });
+        passed &= check(maxError(result, inputGrad), 0.0, 1e-5, "backpropConvolutional " + shape);
+
+        result = weightsGrad;
+        emu::run({size_t(outputChannels*inputChannels), size_t(kernelWidth), size_t(kernelHeight)}, {}, [&]
+        {
+            convolutional::weightsGradConvolutional(result.data(), outputGrad.data(), input.data(), batchSize, outputChannels, outputWidth, outputHeight, inputChannels);
+        });
+        passed &= check(maxError(result, expectedWeightsGrad), 0.0, 1e-4, "weightsGradConvolutional " + shape);
+
+        result = biasGrad;
+        emu::run({size_t(outputChannels), size_t(outputWidth), size_t(outputHeight)}, {}, [&]
+        {
+            convolutional::biasGradConvolutional(result.data(), outputGrad.data(), batchSize);
+        });
+        passed &= check(maxError(result, expectedBiasGrad), 0.0, 1e-5, "biasGradConvolutional " + shape);
+
+        if (kernelWidth != 3 || kernelHeight != 3)
+            continue;
+
+        std::vector<float> U(16 * outputChannels * inputChannels);
+        emu::run({size_t(outputChannels), size_t(inputChannels)}, {}, [&]
+        {
+            convolutional::winogradWeightsConvolutional(U.data(), weights.data());
+        });
+
+        result.assign(output.size(), 0.0f);
+        emu::run({size_t(batchSize*outputChannels), size_t((outputWidth+1) / 2), size_t((outputHeight+1) / 2)}, {}, [&]
+        {
+            convolutional::feedForwardWinograd(result.data(), input.data(), U.data(), bias.data(), inputChannels, outputWidth, outputHeight, outputChannels);
+        });
+        passed &= check(maxError(result, output), 0.0, 1e-4, "feedForwardWinograd " + shape);
+    }
+
+    return passed;
+}
+
+bool maxPoolingKernels()
+{
+    bool passed = true;
+
+    // batchSize, channels, width, height, poolWidth, poolHeight: the last cells of uneven sizes belong to no window
+    const int shapes[][6] = {{1, 1, 4, 4, 2, 2}, {3, 2, 9, 8, 2, 3}, {2, 3, 7, 5, 3, 1}};
+
+    for (const auto& s: shapes)
+    {
+        int batchSize = s[0], channels = s[1], width = s[2], height = s[3], poolWidth = s[4], poolHeight = s[5];
+        int outputWidth = width / poolWidth, outputHeight = height / poolHeight;
+        int planes = batchSize * channels;
+
+        std::vector<float> input(planes * width * height), outputGrad(planes * outputWidth * outputHeight);
+        randomize(input.data(), input.size());
+        randomize(outputGrad.data(), outputGrad.size());
+
+        std::vector<double> output(outputGrad.size());
+        std::vector<int> argmax(outputGrad.size());
+
+        for (int p(0) ; p < planes ; p++)
+        for (int x(0) ; x < outputWidth ; x++)
+        for (int y(0) ; y < outputHeight ; y++)
+        {
+            int index = (p*outputWidth + x)*outputHeight + y;
+            output[index] = -1e9;
+
+            for (int u(0) ; u < poolWidth ; u++)
+            for (int v(0) ; v < poolHeight ; v++)
+            {
+                int inputIndex = (p*width + poolWidth*x + u)*height + poolHeight*y + v;
+
+                if (input[inputIndex] > output[index])
+                {
+                    output[index] = input[inputIndex];
+                    argmax[index] = inputIndex;
+                }
+            }
+        }
+
+        std::string shape = std::to_string(planes) + "x" + std::to_string(width) + "x" + std::to_string(height)
+                          + " pool " + std::to_string(poolWidth) + "x" + std::to_string(poolHeight);
+
+        // Samples and channels share the first dimension of the range
+        std::vector<float> result(output.size());
+        std::vector<int> indices(output.size(), -1);
+        emu::run({size_t(planes), size_t(outputWidth), size_t(outputHeight)}, {}, [&]
+        {
+            maxPooling::feedForwardMaxPooling(result.data(), indices.data(), input.data(), poolWidth, poolHeight, width, height);
+        });
+
+        size_t wrongIndices = 0;
+        for (size_t i(0) ; i < indices.size() ; i++)
+            wrongIndices += indices[i] != argmax[i];
+
+        passed &= check(maxError(result, output), 0.0, 0.0, "feedForwardMaxPooling " + shape);
+        passed &= check(wrongIndices, 0, 0.0, "feedForwardMaxPooling indices " + shape);
+
+        // Each argmax receives the gradient of its output, every other cell 0, including the cells outside any window
+        std::vector<double> inputGrad(input.size(), 0.0);
+        for (size_t i(0) ; i < argmax.size() ; i++)
+            inputGrad[argmax[i]] = outputGrad[i];
+
+        // Garbage in the result catches cells that the kernel would not write
+        std::vector<float> gathered(input.size());
+        randomize(gathered.data(), gathered.size(), 1e3f, 1e4f);
+        emu::run({size_t(planes), size_t(width), size_t(height)}, {}, [&]
+        {
+            maxPooling::backpropMaxPooling(gathered.data(), outputGrad.data(), indices.data(), poolWidth, poolHeight, outputWidth, outputHeight);
+        });
+
+        passed &= check(maxError(gathered, inputGrad), 0.0, 0.0, "backpropMaxPooling " + shape);
+    }
+
+    return passed;
+}
+
+bool adamKernel()
+{
+    bool passed = true;
+
+    const float learningRate = 0.01f, rho1 = 0.9f, rho2 = 0.999f, delta = 1e-7f, gradScale = 0.5f;
+
+    // Three tensors of uneven sizes in one launch, the five unused slots repeat the last one with an empty range
+    const size_t sizes[] = {7, 130, 1};
+    const size_t tensors = 3, slots = 8;
+
+    std::vector<std::vector<float>> params(tensors), paramsGrad(tensors), s(tensors), r(tensors);
+    std::vector<std::vector<double>> expected(tensors), expectedS(tensors), expectedR(tensors);
+    std::vector<int> ends(slots);
+
+    int end = 0;
+    for (size_t t(0) ; t < slots ; t++)
+    {
+        if (t < tensors)
+        {
+            params[t].resize(sizes[t]);
+            randomize(params[t].data(), sizes[t]);
+
+            s[t].assign(sizes[t], 0.0f);
+            r[t].assign(sizes[t], 0.0f);
+
+            expected[t].assign(params[t].begin(), params[t].end());
+            expectedS[t].assign(sizes[t], 0.0);
+            expectedR[t].assign(sizes[t], 0.0);
+
+            end += sizes[t];
+        }
+
+        ends[t] = end;
+    }
+
+    for (int iteration(1) ; iteration <= 5 ; iteration++)
+    {
+        std::vector<std::vector<double>> grads(tensors);
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            paramsGrad[t].resize(sizes[t]);
+            randomize(paramsGrad[t].data(), sizes[t]);
+            grads[t].assign(paramsGrad[t].begin(), paramsGrad[t].end());
+        }
+
+        // Textbook Adam with bias-corrected moments
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            for (size_t i(0) ; i < sizes[t] ; i++)
+            {
+                double g = gradScale * grads[t][i];
+                expectedS[t][i] = rho1 * expectedS[t][i] + (1.0 - rho1) * g;
+                expectedR[t][i] = rho2 * expectedR[t][i] + (1.0 - rho2) * g*g;
+
+                double sHat = expectedS[t][i] / (1.0 - std::pow(double(rho1), iteration));
+                double rHat = expectedR[t][i] / (1.0 - std::pow(double(rho2), iteration));
+                expected[t][i] -= learningRate * sHat / (delta + std::sqrt(rHat));
+            }
+        }
+
+        // As Adam::updateParams
+        float stepSize = learningRate / (1.0f - std::pow(rho1, float(iteration)));
+        float rCorrection = 1.0f / (1.0f - std::pow(rho2, float(iteration)));
+
+        auto slot = [&](size_t _t) { return std::min(_t, tensors-1); };
+        #define RNA_ADAM_TENSOR(n) params[slot(n)].data(), paramsGrad[slot(n)].data(), s[slot(n)].data(), r[slot(n)].data(), ends[n]
+
+        emu::run({size_t(end)}, {}, [&]
+        {
+            adam::updateParams(gradScale, stepSize, rho1, rho2, rCorrection, delta,
+                               RNA_ADAM_TENSOR(0), RNA_ADAM_TENSOR(1), RNA_ADAM_TENSOR(2), RNA_ADAM_TENSOR(3),
+                               RNA_ADAM_TENSOR(4), RNA_ADAM_TENSOR(5), RNA_ADAM_TENSOR(6), RNA_ADAM_TENSOR(7));
+        });
+
+        #undef RNA_ADAM_TENSOR
+
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            std::string what = "updateParams tensor " + std::to_string(t) + " iteration " + std::to_string(iteration);
+
+            passed &= check(maxError(params[t], expected[t]), 0.0, 1e-5, what);
+            passed &= check(maxError(s[t], expectedS[t]), 0.0, 1e-6, what + " s");
+            passed &= check(maxError(r[t], expectedR[t]), 0.0, 1e-6, what + " r");
+            passed &= check(maxError(paramsGrad[t], std::vector<double>(sizes[t], 0.0)), 0.0, 0.0, what + " gradient reset");
+        }
+    }
+
+    return passed;
+}
+
+
+bool sgdKernel()
+{
+    bool passed = true;
+
+    const float learningRate = 0.05f, inertia = 0.8f, gradScale = 0.25f;
+
+    // Four tensors of uneven sizes in one launch, the four unused slots repeat the last one with an empty range
+    const size_t sizes[] = {33, 1, 64, 5};
+    const size_t tensors = 4, slots = 8;
+
+    std::vector<std::vector<float>> params(tensors), paramsGrad(tensors), deltas(tensors);
+    std::vector<std::vector<double>> expected(tensors), expectedDeltas(tensors);
+    std::vector<int> ends(slots);
+
+    int end = 0;
+    for (size_t t(0) ; t < slots ; t++)
+    {
+        if (t < tensors)
+        {
+            params[t].resize(sizes[t]);
+            randomize(params[t].data(), sizes[t]);
+            deltas[t].assign(sizes[t], 0.0f);
+
+            expected[t].assign(params[t].begin(), params[t].end());
+            expectedDeltas[t].assign(sizes[t], 0.0);
+
+            end += sizes[t];
+        }
+
+        ends[t] = end;
+    }
+
+    for (int iteration(1) ; iteration <= 4 ; iteration++)
+    {
+        // Momentum on the scaled gradient
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            paramsGrad[t].resize(sizes[t]);
+            randomize(paramsGrad[t].data(), sizes[t]);
+
+            for (size_t i(0) ; i < sizes[t] ; i++)
+            {
+                expectedDeltas[t][i] = inertia * expectedDeltas[t][i] - learningRate * (gradScale * double(paramsGrad[t][i]));
+                expected[t][i] += expectedDeltas[t][i];
+            }
+        }
+
+        auto slot = [&](size_t _t) { return std::min(_t, tensors-1); };
+        #define RNA_SGD_TENSOR(n) params[slot(n)].data(), paramsGrad[slot(n)].data(), deltas[slot(n)].data(), ends[n]
+
+        emu::run({size_t(end)}, {}, [&]
+        {
+            sgd::updateParams(gradScale, learningRate, inertia,
+                              RNA_SGD_TENSOR(0), RNA_SGD_TENSOR(1), RNA_SGD_TENSOR(2), RNA_SGD_TENSOR(3),
+                              RNA_SGD_TENSOR(4), RNA_SGD_TENSOR(5), RNA_SGD_TENSOR(6), RNA_SGD_TENSOR(7));
+        });
+
+        #undef RNA_SGD_TENSOR
+
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            std::string what = "updateParams tensor " + std::to_string(t) + " iteration " + std::to_string(iteration);
+
+            passed &= check(maxError(params[t], expected[t]), 0.0, 1e-6, what);
+            passed &= check(maxError(deltas[t], expectedDeltas[t]), 0.0, 1e-6, what + " delta");
+            passed &= check(maxError(paramsGrad[t], std::vector<double>(sizes[t], 0.0)), 0.0, 0.0, what + " gradient reset");
+        }
+    }
+
+    return passed;
+}
+
+bool rmspropKernel()
+{
+    bool passed = true;
+
+    const float learningRate = 0.01f, rho = 0.9f, delta = 1e-6f, gradScale = 0.125f;
+
+    // All eight slots in use, with an empty tensor in the middle
+    const size_t sizes[] = {3, 70, 1, 0, 17, 2, 40, 9};
+    const size_t tensors = 8;
+
+    std::vector<std::vector<float>> params(tensors), paramsGrad(tensors), r(tensors);
+    std::vector<std::vector<double>> expected(tensors), expectedR(tensors);
+    std::vector<int> ends(tensors);
+
+    int end = 0;
+    for (size_t t(0) ; t < tensors ; t++)
+    {
+        params[t].resize(sizes[t]);
+        randomize(params[t].data(), sizes[t]);
+        r[t].assign(sizes[t], 0.0f);
+
+        expected[t].assign(params[t].begin(), params[t].end());
+        expectedR[t].assign(sizes[t], 0.0);
+
+        end += sizes[t];
+        ends[t] = end;
+    }
+
+    for (int iteration(1) ; iteration <= 4 ; iteration++)
+    {
+        // Running mean of the squared scaled gradient
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            paramsGrad[t].resize(sizes[t]);
+            randomize(paramsGrad[t].data(), sizes[t]);
+
+            for (size_t i(0) ; i < sizes[t] ; i++)
+            {
+                double g = gradScale * double(paramsGrad[t][i]);
+                expectedR[t][i] = rho * expectedR[t][i] + (1.0 - rho) * g*g;
+                expected[t][i] -= learningRate * g / std::sqrt(delta + expectedR[t][i]);
+            }
+        }
+
+        #define RNA_RMSPROP_TENSOR(n) params[n].data(), paramsGrad[n].data(), r[n].data(), ends[n]
+
+        emu::run({size_t(end)}, {}, [&]
+        {
+            rmsprop::updateParams(gradScale, learningRate, rho, delta,
+                                  RNA_RMSPROP_TENSOR(0), RNA_RMSPROP_TENSOR(1), RNA_RMSPROP_TENSOR(2), RNA_RMSPROP_TENSOR(3),
+                                  RNA_RMSPROP_TENSOR(4), RNA_RMSPROP_TENSOR(5), RNA_RMSPROP_TENSOR(6), RNA_RMSPROP_TENSOR(7));
+        });
+
+        #undef RNA_RMSPROP_TENSOR
+
+        for (size_t t(0) ; t < tensors ; t++)
+        {
+            std::string what = "updateParams tensor " + std::to_string(t) + " iteration " + std::to_string(iteration);
+
+            passed &= check(maxError(params[t], expected[t]), 0.0, 1e-5, what);
+            passed &= check(maxError(r[t], expectedR[t]), 0.0, 1e-6, what + " r");
+            passed &= check(maxError(paramsGrad[t], std::vector<double>(sizes[t], 0.0)), 0.0, 0.0, what + " gradient reset");
+        }
+    }
+
+    return passed;
+}
+
+bool lossKernels()
+{
+    bool passed = true;
+
+    // One work item per sample, logits up to |x| = 100 and a last row near 100 everywhere
+    const int batchSize = 5, width = 11;
+
+    std::vector<float> estimation(batchSize * width), target(batchSize), gradient(estimation.size());
+    randomize(estimation.data(), estimation.size(), -100.0f, 100.0f);
+    randomize(estimation.data() + (batchSize-1)*width, width, 99.0f, 101.0f);
+
+    for (int n(0) ; n < batchSize ; n++)
+        target[n] = (n * 4 + 1) % width;
+
+    // Softmax minus one-hot
+    std::vector<double> expected(estimation.size());
+    for (int n(0) ; n < batchSize ; n++)
+    {
+        const float* logits = estimation.data() + n*width;
+        double maxLogit = *std::max_element(logits, logits + width), sum = 0.0;
+
+        for (int i(0) ; i < width ; i++)
+            sum += std::exp(logits[i] - maxLogit);
+
+        for (int i(0) ; i < width ; i++)
+            expected[n*width + i] = std::exp(logits[i] - maxLogit) / sum - (i == int(target[n])? 1.0: 0.0);
+    }
+
+    emu::run({size_t(batchSize)}, {}, [&]
+    {
+        losses::gradientCrossEntropy(gradient.data(), estimation.data(), target.data(), width);
+    });
+
+    passed &= check(maxError(gradient, expected), 0.0, 1e-6, "gradientCrossEntropy");
+
+    return passed;
+}
+
+
+bool dropoutKernels()
+{
+    bool passed = true;
+
+    const uint64_t seed = 0x243F6A8885A308D3;
+
+    // Sizes around the 32 units of a mask word, two runs to cover the run counter
+    for (float rate: {0.3f, 0.5f})
+    {
+        for (size_t size: {1, 31, 32, 33, 100, 1000})
+        {
+            std::vector<float> input(size), outputGrad(size);
+            randomize(input.data(), size, 0.5f, 1.0f);
+            randomize(outputGrad.data(), size);
+
+            Tensor cpuInput({size}), cpuOutputGrad({size});
+            std::copy(input.begin(), input.end(), cpuInput.data());
+            std::copy(outputGrad.begin(), outputGrad.end(), cpuOutputGrad.data());
+
+            rna::Dropout layer(rate);
+            layer.setSeed(seed);
+
+            // As Dropout::threshold and Dropout::scale
+            const uint threshold = uint(rate * 4294967296.0);
+            const float scale = 1.0f / (1.0f - rate);
+
+            for (uint run(0) ; run < 2 ; run++)
+            {
+                std::string what = std::to_string(size) + " units rate " + std::to_string(rate).substr(0, 3) + " run " + std::to_string(run);
+
+                layer.feedForward(cpuInput);
+                layer.backprop(cpuInput, cpuOutputGrad);
+
+                const Tensor& output = layer.getOutput();
+                const Tensor& inputGrad = layer.getInputGrad();
+
+                std::vector<float> result(size), gradient(size);
+                std::vector<uint> mask((size + 31) / 32);
+
+                emu::run({mask.size()}, {}, [&]
+                {
+                    dropout::feedForwardDropout(result.data(), input.data(), mask.data(), size, uint(seed), uint(seed >> 32), run, 0, threshold, scale);
+                });
+
+                emu::run({size}, {}, [&]
+                {
+                    dropout::backpropDropout(gradient.data(), outputGrad.data(), mask.data(), scale);
+                });
+
+                passed &= check(maxError(result, std::vector<double>(output.data(), output.data() + size)), 0.0, 0.0, "feedForwardDropout " + what);
+                passed &= check(maxError(gradient, std::vector<double>(inputGrad.data(), inputGrad.data() + size)), 0.0, 0.0, "backpropDropout " + what);
+
+                // Padding bits of the last word stay clear
+                if (size % 32)
+                    passed &= check(mask.back() >> (size % 32), 0, 0.0, "mask padding " + what);
+            }
+        }
+    }
+
+    return passed;
+}
+
+}
@@ -0,0 +1,180 @@
+#include "unit.h"
+
+#include "RNA/RNA.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Unit
+{
+
+namespace
+{
+
+double difference(const Tensor& _a, const std::vector<double>& _b)
+{
+    if (_a.nElements() != _b.size())
+        return 1e9;
+
+    double error = 0.0;
+    // NaN propagates, so that overflows fail the check
+    for (size_t i(0) ; i < _b.size() ; i++)
+        if (!(std::abs(_a[i] - _b[i]) <= error))
+            error = std::abs(_a[i] - _b[i]);
+
+    return error;
+}
+
+// Sample _n of a batch, or the tensor itself when it is not batched
+Tensor sample(const Tensor& _batch, size_t _n, bool _batched)
+{
+    if (!_batched)
+        return _batch;
+
+    Tensor result({_batch.size(1), _batch.size(2), _batch.size(3)});
+    std::copy(_batch.data() + _n * result.nElements(), _batch.data() + (_n+1) * result.nElements(), result.data());
+
+    return result;
+}
+
+}
+
+bool convolutionalAlgorithms()
+{
+    typedef rna::Convolutional::Algorithm Algorithm;
+
+    bool passed = true;
+
+    // inputChannels, width, height, kernelWidth, kernelHeight, outputChannels
+    // The first shape is small enough for the direct loops of Algorithm::DEFAULT, the others go through im2col + gemm
+    const int shapes[][6] = {{1, 5, 6, 3, 3, 2}, {3, 12, 11, 3, 3, 4}, {2, 13, 9, 5, 4, 3}};
+
+    for (const auto& s: shapes)
+    {
+        size_t channels = s[0], width = s[1], height = s[2], kernelWidth = s[3], kernelHeight = s[4], outputChannels = s[5];
+        size_t outputWidth = width - kernelWidth + 1, outputHeight = height - kernelHeight + 1;
+
+        for (size_t batchSize: {0, 3})
+        {
+            bool batched = batchSize > 0;
+            size_t samples = batched? batchSize: 1;
+
+            Tensor input(batched? coords_t{batchSize, channels, width, height}: coords_t{channels, width, height});
+            Tensor outputGrad(batched? coords_t{batchSize, outputChannels, outputWidth, outputHeight}: coords_t{outputChannels, outputWidth, outputHeight});
+            randomize(input.data(), input.nElements());
+            randomize(outputGrad.data(), outputGrad.nElements());
+
+            rna::Convolutional layer({channels, width, height}, {kernelWidth, kernelHeight}, outputChannels);
+
+            std::vector<Tensor*> params, paramsGrad;
+            layer.getParams(params, paramsGrad);
+            const Tensor& weights = *params[0];
+            const Tensor& bias = *params[1];
+
+            // Direct convolution, weight (u, v) meeting pixel (x + kw-1-u, y + kh-1-v), and the gradients of the direct CPU path
+            std::vector<double> output(outputGrad.nElements()), inputGrad, weightsGrad(weights.nElements(), 0.0), biasGrad(bias.nElements(), 0.0);
+
+            for (size_t n(0) ; n < samples ; n++)
+            {
+                Tensor x = sample(input, n, batched), dy = sample(outputGrad, n, batched);
+
+                for (size_t o(0) ; o < outputChannels ; o++)
+                for (size_t i(0) ; i < outputWidth ; i++)
+                for (size_t j(0) ; j < outputHeight ; j++)
+                {
+                    double sum = bias(o, i, j);
+
+                    for (size_t c(0) ; c < channels ; c++)
+                    for (size_t u(0) ; u < kernelWidth ; u++)
+                    for (size_t v(0) ; v < kernelHeight ; v++)
+                        sum += double(weights({o, c, u, v})) * x(c, i + kernelWidth-1-u, j + kernelHeight-1-v);
+
+                    output[((n*outputChannels + o)*outputWidth + i)*outputHeight + j] = sum;
+                }
+
+                Tensor dx, dw(weights.size(), 0.0);
+                rna::convGradInput(dx, weights, dy);
+                rna::convGradWeight(dw, dy, x);
+
+                inputGrad.insert(inputGrad.end(), dx.data(), dx.data() + dx.nElements());
+                for (size_t i(0) ; i < dw.nElements() ; i++)
+                    weightsGrad[i] += dw[i];
+                for (size_t i(0) ; i < dy.nElements() ; i++)
+                    biasGrad[i] += dy[i];
+            }
+
+            std::vector<Algorithm> algorithms = {Algorithm::DEFAULT, Algorithm::FFT};
+            if (kernelWidth == 3 && kernelHeight == 3)
+                algorithms.push_back(Algorithm::WINOGRAD);
+
+            for (Algorithm algorithm: algorithms)
+            {
+                std::string what = std::string(algorithm == Algorithm::DEFAULT? "default": algorithm == Algorithm::FFT? "fft": "winograd")
+                                 + (batched? " batch ": " sample ") + std::to_string(channels) + "x" + std::to_string(width) + "x" + std::to_string(height)
+                                 + " kernel " + std::to_string(kernelWidth) + "x" + std::to_string(kernelHeight);
+
+                layer.setAlgorithm(algorithm);
+
+                paramsGrad[0]->fill(0.0);
+                paramsGrad[1]->fill(0.0);
+
+                layer.feedForward(input);
+                layer.backprop(input, outputGrad);
+
+                passed &= check(difference(layer.getOutput(), output), 0.0, 1e-4, what + " output");
+                passed &= check(difference(layer.getInputGrad(), inputGrad), 0.0, 1e-4, what + " inputGrad");
+                passed &= check(difference(*paramsGrad[0], weightsGrad), 0.0, 1e-4, what + " weightsGrad");
+                passed &= check(difference(*paramsGrad[1], biasGrad), 0.0, 1e-4, what + " biasGrad");
+            }
+        }
+    }
+
+    return passed;
+}
+
+
+bool crossEntropy()
+{
+    bool passed = true;
+
+    rna::CrossEntropy crossEntropy;
+    rna::NLL nll;
+    rna::LogSoftMax logSoftMax;
+
+    // Logits up to |x| = 100 overflow exp() in single precision unless the maximum is subtracted first,
+    // the last row is close to 100 everywhere so that even the smallest term overflows
+    for (size_t batchSize: {0, 6})
+    {
+        bool batched = batchSize > 0;
+        size_t rows = batched? batchSize: 1, width = batched? 7: 9;
+
+        Tensor logits(batched? coords_t{rows, width}: coords_t{width}), target({rows, 1});
+        randomize(logits.data(), logits.nElements(), -100.0f, 100.0f);
+        if (batched)
+            randomize(logits.data() + (rows-1)*width, width, 99.0f, 101.0f);
+
+        for (size_t i(0) ; i < rows ; i++)
+            target[i] = (i * 5 + 3) % width;
+
+        // LogSoftMax followed by NLL, the gradient going back through LogSoftMax
+        logSoftMax.feedForward(logits);
+        Tensor::value_type loss = nll.getLoss(logSoftMax.getOutput(), target);
+
+        logSoftMax.backprop(logits, nll.getGradient(logSoftMax.getOutput(), target));
+        const Tensor& gradient = logSoftMax.getInputGrad();
+
+        std::string what = batched? "batch": "sample";
+
+        Tensor::value_type fused = crossEntropy.getLoss(logits, target);
+        passed &= check(std::isfinite(fused), true, 0.0, what + " finite loss");
+        passed &= check(fused, loss, 1e-4 * std::abs(loss), what + " getLoss");
+
+        std::vector<double> expected(gradient.data(), gradient.data() + gradient.nElements());
+        passed &= check(difference(crossEntropy.getGradient(logits, target), expected), 0.0, 1e-5, what + " getGradient");
+    }
+
+    return passed;
+}
+
+}
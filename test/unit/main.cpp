@@ -0,0 +1,76 @@
+#include "unit.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace Unit
+{
+
+bool check(double _value, double _reference, double _tolerance, const std::string& _what)
+{
+    if (std::abs(_value - _reference) <= _tolerance)
+        return true;
+
+    std::cout << "    " << _what << ": " << _value << " instead of " << _reference << std::endl;
+    return false;
+}
+
+void randomize(float* _values, size_t _n, float _min, float _max)
+{
+    static std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(_min, _max);
+
+    for (size_t i(0) ; i < _n ; i++)
+        _values[i] = distribution(generator);
+}
+
+}
+
+int main()
+{
+    struct Test
+    {
+        const char* name;
+        bool (*run)();
+    };
+
+    const Test tests[] =
+    {
+        {"gemm", Unit::gemm},
+        {"bfloat16", Unit::bfloat16},
+        {"im2col", Unit::im2col},
+        {"winograd", Unit::winograd},
+        {"fft", Unit::fft},
+        {"int8", Unit::int8},
+        {"philox", Unit::philox},
+        {"activations", Unit::activations},
+        {"checkpointing", Unit::checkpointing},
+        {"fusion", Unit::fusion},
+        {"gradientSharing", Unit::gradientSharing},
+        {"binaryFormat", Unit::binaryFormat},
+        {"convolutionalAlgorithms", Unit::convolutionalAlgorithms},
+        {"crossEntropy", Unit::crossEntropy},
+        {"linearKernels", Unit::linearKernels},
+        {"convolutionalKernels", Unit::convolutionalKernels},
+        {"maxPoolingKernels", Unit::maxPoolingKernels},
+        {"sgdKernel", Unit::sgdKernel},
+        {"rmspropKernel", Unit::rmspropKernel},
+        {"adamKernel", Unit::adamKernel},
+        {"lossKernels", Unit::lossKernels},
+        {"dropoutKernels", Unit::dropoutKernels}
+    };
+
+    int failures = 0;
+    for (const Test& test: tests)
+    {
+        bool passed = test.run();
+        std::cout << (passed? "ok      ": "FAILED  ") << test.name << std::endl;
+
+        failures += !passed;
+    }
+
+    std::cout << std::endl << failures << " failed" << std::endl;
+
+    return failures? 1: 0;
+}
@@ -0,0 +1,548 @@
+#include "unit.h"
+
+#include "RNA/Maths/activations.h"
+#include "RNA/Maths/fft.h"
+#include "RNA/Maths/gemm.h"
+#include "RNA/Maths/im2col.h"
+#include "RNA/Maths/int8.h"
+#include "RNA/Maths/philox.h"
+#include "RNA/Maths/winograd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Unit
+{
+
+namespace
+{
+
+uint32_t bits(float _value)
+{
+    uint32_t b;
+    std::memcpy(&b, &_value, sizeof(b));
+
+    return b;
+}
+
+float fromBits(uint32_t _bits)
+{
+    float value;
+    std::memcpy(&value, &_bits, sizeof(value));
+
+    return value;
+}
+
+// Reference for both gemm overloads, with op(B) read through _b
+template<typename T, typename Widen>
+bool compareGemm(bool _transA, bool _transB, size_t _m, size_t _n, size_t _k, float _beta, Widen _widen)
+{
+    size_t lda = (_transA? _m: _k) + 1, ldb = (_transB? _k: _n) + 2, ldc = _n + 3;
+
+    std::vector<float> A((_transA? _k: _m) * lda), B((_transB? _n: _k) * ldb), C(_m * ldc);
+    randomize(A.data(), A.size());
+    randomize(B.data(), B.size());
+    randomize(C.data(), C.size());
+
+    std::vector<T> b(B.size());
+    for (size_t i(0) ; i < B.size() ; i++)
+        b[i] = _widen.narrow(B[i]);
+
+    // C is not read when beta is 0
+    if (_beta == 0.0f)
+        C.assign(C.size(), std::numeric_limits<float>::quiet_NaN());
+
+    std::vector<double> reference(_m * _n);
+    for (size_t i(0) ; i < _m ; i++)
+    {
+        for (size_t j(0) ; j < _n ; j++)
+        {
+            double sum = 0.0;
+            for (size_t p(0) ; p < _k ; p++)
+                sum += double(_transA? A[p*lda + i]: A[i*lda + p]) * _widen(_transB? b[j*ldb + p]: b[p*ldb + j]);
+
+            reference[i*_n + j] = 1.5 * sum + (_beta == 0.0f? 0.0: _beta * C[i*ldc + j]);
+        }
+    }
+
+    rna::gemm(_transA, _transB, _m, _n, _k, 1.5f, A.data(), lda, b.data(), ldb, _beta, C.data(), ldc);
+
+    double error = 0.0;
+    for (size_t i(0) ; i < _m ; i++)
+    {
+        for (size_t j(0) ; j < _n ; j++)
+            error = std::max(error, std::isnan(C[i*ldc + j])? 1e9: std::abs(C[i*ldc + j] - reference[i*_n + j]));
+    }
+
+    return check(error, 0.0, 1e-5 * (_k + 1), "gemm " + std::to_string(_m) + "x" + std::to_string(_n) + "x" + std::to_string(_k)
+                                                 + (_transA? " A^T": "") + (_transB? " B^T": "") + " beta " + std::to_string(_beta));
+}
+
+struct Single
+{
+    float narrow(float _value) const { return _value; }
+    double operator()(float _value) const { return _value; }
+};
+
+struct Brain
+{
+    rna::bfloat16 narrow(float _value) const { return rna::toBFloat16(_value); }
+    double operator()(rna::bfloat16 _value) const { return rna::toFloat(_value); }
+};
+
+}
+
+bool gemm()
+{
+    bool passed = true;
+
+    // Sizes around the register blocks and cache tiles, so that every edge case is met
+    for (bool transA: {false, true})
+    {
+        for (bool transB: {false, true})
+        {
+            for (size_t m: {1, 5, 6, 17, 130})
+            {
+                for (size_t n: {1, 7, 16, 33, 300})
+                {
+                    for (size_t k: {1, 3, 260, 600})
+                    {
+                        for (float beta: {0.0f, 1.0f, 0.5f})
+                            passed &= compareGemm<float>(transA, transB, m, n, k, beta, Single());
+                    }
+
+                    passed &= compareGemm<rna::bfloat16>(transA, transB, m, n, 70, 0.0f, Brain());
+                }
+            }
+        }
+    }
+
+    // Row broadcast and reduction used for the bias
+    std::vector<float> A(7*13), sums(13, 1.0f), row(13);
+    randomize(A.data(), A.size());
+    randomize(row.data(), row.size());
+
+    rna::addRows(sums.data(), A.data(), 7, 13);
+    for (size_t j(0) ; j < 13 ; j++)
+    {
+        double sum = 1.0;
+        for (size_t i(0) ; i < 7 ; i++)
+            sum += A[i*13 + j];
+
+        passed &= check(sums[j], sum, 1e-5, "addRows");
+    }
+
+    rna::broadcastRows(A.data(), row.data(), 7, 13);
+    for (size_t i(0) ; i < A.size() ; i++)
+        passed &= check(A[i], row[i % 13], 0.0, "broadcastRows");
+
+    return passed;
+}
+
+bool bfloat16()
+{
+    bool passed = true;
+
+    // Round to nearest, ties to even
+    const uint32_t cases[][2] =
+    {
+        {0x3f800000, 0x3f80}, // 1
+        {0x3f808000, 0x3f80}, // Tie, even below
+        {0x3f818000, 0x3f82}, // Tie, even above
+        {0x3f808001, 0x3f81},
+        {0xbf80ffff, 0xbf81},
+        {0x7f7fffff, 0x7f80}, // Largest float rounds to infinity
+        {0xff800000, 0xff80},
+        {0x00000001, 0x0000}  // Denormals round like any other value
+    };
+
+    for (const auto& c: cases)
+        passed &= check(rna::toBFloat16(fromBits(c[0])), c[1], 0.0, "toBFloat16 " + std::to_string(c[0]));
+
+    passed &= check(std::isnan(rna::toFloat(rna::toBFloat16(std::numeric_limits<float>::quiet_NaN()))), 1, 0.0, "NaN stays NaN");
+    passed &= check(std::isnan(rna::toFloat(rna::toBFloat16(fromBits(0x7f800001)))), 1, 0.0, "Signaling NaN stays NaN");
+
+    // The vectorized conversion matches the scalar one, including the tail and special values
+    std::vector<float> values(1003);
+    randomize(values.data(), values.size(), -1e3f, 1e3f);
+    for (size_t i(0) ; i < values.size() ; i += 97)
+        values[i] = fromBits(uint32_t(0x7f800000 + i));
+    values[5] = fromBits(0x3f808000);
+    values[6] = fromBits(0x3f818000);
+
+    std::vector<rna::bfloat16> converted(values.size());
+    rna::toBFloat16(converted.data(), values.data(), values.size());
+
+    size_t mismatches = 0;
+    for (size_t i(0) ; i < values.size() ; i++)
+        mismatches += converted[i] != rna::toBFloat16(values[i]);
+
+    passed &= check(mismatches, 0, 0.0, "Vectorized toBFloat16 mismatches");
+
+    // Rounding to 8 significant bits: the relative error is at most 2^-8
+    double error = 0.0;
+    for (size_t i(0) ; i < values.size() ; i++)
+    {
+        if (std::isfinite(values[i]) && values[i] != 0.0f)
+            error = std::max(error, std::abs((double(rna::toFloat(converted[i])) - values[i]) / values[i]));
+    }
+
+    passed &= check(error, 0.0, 1.0 / 256, "bfloat16 relative error");
+    passed &= check(bits(rna::toFloat(0x3f80)), 0x3f800000, 0.0, "toFloat");
+
+    return passed;
+}
+
+bool im2col()
+{
+    bool passed = true;
+
+    // The second shape is large enough to be split across threads
+    const size_t shapes[][5] = {{3, 7, 5, 3, 2}, {8, 40, 40, 5, 5}};
+
+    for (const auto& s: shapes)
+    {
+        size_t channels = s[0], width = s[1], height = s[2], kernelWidth = s[3], kernelHeight = s[4];
+        size_t outputWidth = width - kernelWidth + 1, outputHeight = height - kernelHeight + 1;
+        size_t rows = channels * kernelWidth * kernelHeight, columns = outputWidth * outputHeight;
+
+        std::vector<float> image(channels * width * height), lowered(rows * columns);
+        randomize(image.data(), image.size());
+
+        rna::im2col(lowered.data(), image.data(), channels, width, height, kernelWidth, kernelHeight);
+
+        double error = 0.0;
+        for (size_t c(0) ; c < channels ; c++)
+        for (size_t u(0) ; u < kernelWidth ; u++)
+        for (size_t v(0) ; v < kernelHeight ; v++)
+        for (size_t x(0) ; x < outputWidth ; x++)
+        for (size_t y(0) ; y < outputHeight ; y++)
+        {
+            // Kernels are flipped: weight (u, v) meets pixel (x + kw-1-u, y + kh-1-v)
+            float expected = image[(c*width + x + kernelWidth-1-u) * height + y + kernelHeight-1-v];
+            float actual = lowered[((c*kernelWidth + u)*kernelHeight + v) * columns + x*outputHeight + y];
+
+            error = std::max(error, double(std::abs(actual - expected)));
+        }
+
+        passed &= check(error, 0.0, 0.0, "im2col");
+
+        // col2im is the adjoint: <im2col(x), y> = <x, col2im(y)>
+        std::vector<float> gradient(rows * columns), accumulated(image.size(), 0.0f);
+        randomize(gradient.data(), gradient.size());
+
+        rna::col2im(accumulated.data(), gradient.data(), channels, width, height, kernelWidth, kernelHeight);
+
+        double left = 0.0, right = 0.0;
+        for (size_t i(0) ; i < lowered.size() ; i++)
+            left += double(lowered[i]) * gradient[i];
+        for (size_t i(0) ; i < image.size() ; i++)
+            right += double(image[i]) * accumulated[i];
+
+        passed &= check(left, right, 1e-3, "col2im adjoint");
+    }
+
+    return passed;
+}
+
+bool winograd()
+{
+    bool passed = true;
+
+    // Odd output sizes leave partial 2x2 tiles
+    const size_t shapes[][6] = {{1, 1, 1, 4, 4, 0}, {2, 3, 5, 9, 8, 0}, {2, 4, 3, 7, 12, 2}, {1, 2, 2, 3, 3, 1}};
+
+    for (const auto& s: shapes)
+    {
+        size_t batch = s[0], inputChannels = s[1], outputChannels = s[2], width = s[3], height = s[4], padding = s[5];
+        size_t outputWidth = width + 2*padding - 2, outputHeight = height + 2*padding - 2;
+
+        std::vector<float> input(batch * inputChannels * width * height), kernels(outputChannels * inputChannels * 9);
+        randomize(input.data(), input.size());
+        randomize(kernels.data(), kernels.size());
+
+        std::vector<float> U(16 * outputChannels * inputChannels);
+        for (size_t o(0) ; o < outputChannels ; o++)
+        {
+            for (size_t c(0) ; c < inputChannels ; c++)
+                rna::winogradKernel(U.data() + o*inputChannels + c, outputChannels*inputChannels, kernels.data() + (o*inputChannels + c)*9);
+        }
+
+        std::vector<float> output(batch * outputChannels * outputWidth * outputHeight), workspace;
+        rna::winogradCorrelate(output.data(), input.data(), U.data(), batch, inputChannels, outputChannels, width, height, padding, workspace);
+
+        double error = 0.0;
+        for (size_t n(0) ; n < batch ; n++)
+        for (size_t o(0) ; o < outputChannels ; o++)
+        for (size_t x(0) ; x < outputWidth ; x++)
+        for (size_t y(0) ; y < outputHeight ; y++)
+        {
+            double sum = 0.0;
+            for (size_t c(0) ; c < inputChannels ; c++)
+            for (size_t i(0) ; i < 3 ; i++)
+            for (size_t j(0) ; j < 3 ; j++)
+            {
+                size_t u = x + i - padding, v = y + j - padding;
+                if (u < width && v < height)
+                    sum += double(input[((n*inputChannels + c)*width + u)*height + v]) * kernels[(o*inputChannels + c)*9 + 3*i + j];
+            }
+
+            error = std::max(error, std::abs(output[((n*outputChannels + o)*outputWidth + x)*outputHeight + y] - sum));
+        }
+
+        passed &= check(error, 0.0, 1e-4, "winogradCorrelate " + std::to_string(width) + "x" + std::to_string(height) + " padding " + std::to_string(padding));
+    }
+
+    return passed;
+}
+
+bool fft()
+{
+    bool passed = true;
+
+    passed &= check(rna::nextPowerOfTwo(1), 1, 0.0, "nextPowerOfTwo(1)");
+    passed &= check(rna::nextPowerOfTwo(33), 64, 0.0, "nextPowerOfTwo(33)");
+    passed &= check(rna::nextPowerOfTwo(64), 64, 0.0, "nextPowerOfTwo(64)");
+
+    const double pi = std::acos(-1.0);
+
+    for (size_t rows: {1, 4, 16})
+    {
+        for (size_t columns: {2, 8, 32})
+        {
+            std::vector<float> real(rows * columns), imaginary(rows * columns);
+            randomize(real.data(), real.size());
+            randomize(imaginary.data(), imaginary.size());
+
+            std::vector<rna::Complex> data(rows * columns);
+            for (size_t i(0) ; i < data.size() ; i++)
+                data[i] = rna::Complex(real[i], imaginary[i]);
+
+            std::vector<rna::Complex> original = data;
+            rna::fft2d(data.data(), rows, columns, false);
+
+            // Direct DFT, with the usual e^(-2i pi ...) convention
+            double error = 0.0;
+            for (size_t k(0) ; k < rows ; k++)
+            {
+                for (size_t l(0) ; l < columns ; l++)
+                {
+                    std::complex<double> sum = 0.0;
+                    for (size_t r(0) ; r < rows ; r++)
+                    {
+                        for (size_t c(0) ; c < columns ; c++)
+                            sum += std::complex<double>(original[r*columns + c]) * std::polar(1.0, -2.0*pi * (double(k*r) / rows + double(l*c) / columns));
+                    }
+
+                    error = std::max(error, std::abs(std::complex<double>(data[k*columns + l]) - sum));
+                }
+            }
+
+            passed &= check(error, 0.0, 1e-4 * rows * columns, "fft2d " + std::to_string(rows) + "x" + std::to_string(columns));
+
+            // The inverse is normalized
+            rna::fft2d(data.data(), rows, columns, true);
+
+            error = 0.0;
+            for (size_t i(0) ; i < data.size() ; i++)
+                error = std::max(error, double(std::abs(data[i] - original[i])));
+
+            passed &= check(error, 0.0, 1e-5, "inverse fft2d " + std::to_string(rows) + "x" + std::to_string(columns));
+        }
+    }
+
+    // Zero padding of a real plane
+    std::vector<float> plane(5*3);
+    randomize(plane.data(), plane.size());
+
+    std::vector<rna::Complex> spectrum(8*4), padded(8*4, rna::Complex(0.0f));
+    for (size_t x(0) ; x < 5 ; x++)
+    {
+        for (size_t y(0) ; y < 3 ; y++)
+            padded[x*4 + y] = plane[x*3 + y];
+    }
+
+    rna::realToSpectrum(spectrum.data(), plane.data(), 5, 3, 8, 4);
+    rna::fft2d(padded.data(), 8, 4, false);
+
+    double error = 0.0;
+    for (size_t i(0) ; i < spectrum.size() ; i++)
+        error = std::max(error, double(std::abs(spectrum[i] - padded[i])));
+
+    passed &= check(error, 0.0, 1e-5, "realToSpectrum");
+
+    return passed;
+}
+
+bool int8()
+{
+    bool passed = true;
+
+    const size_t shapes[][3] = {{1, 5, 7}, {3, 9, 64}, {37, 70, 100}, {2, 300, 33}};
+
+    for (const auto& s: shapes)
+    {
+        size_t m = s[0], n = s[1], k = s[2], stride = rna::int8Stride(k);
+        const float scale = 1.0f / 127;
+
+        std::vector<float> A(m * k), B(n * k);
+        randomize(A.data(), A.size());
+        randomize(B.data(), B.size());
+
+        std::vector<uint8_t> quantized(m * stride);
+        rna::quantizeRows(quantized.data(), stride, A.data(), m, k, scale);
+
+        rna::Int8Matrix weights;
+        weights.quantize(B.data(), n, k);
+
+        std::vector<float> C(m * n);
+        rna::gemmInt8(m, quantized.data(), scale, weights, C.data(), n);
+
+        // Exact against the integer products, and close to the single precision product
+        double exact = 0.0, approximate = 0.0;
+        for (size_t i(0) ; i < m ; i++)
+        {
+            for (size_t j(0) ; j < n ; j++)
+            {
+                int64_t sum = 0;
+                double real = 0.0;
+
+                for (size_t p(0) ; p < k ; p++)
+                {
+                    sum += (int(quantized[i*stride + p]) - 128) * weights.values[j*stride + p];
+                    real += double(A[i*k + p]) * B[j*k + p];
+                }
+
+                double expected = sum * double(scale) * weights.scales[j];
+
+                exact = std::max(exact, std::abs(C[i*n + j] - expected) / (std::abs(expected) + 1e-3));
+                approximate = std::max(approximate, std::abs(C[i*n + j] - real));
+            }
+        }
+
+        std::string shape = std::to_string(m) + "x" + std::to_string(n) + "x" + std::to_string(k);
+        passed &= check(exact, 0.0, 1e-5, "gemmInt8 " + shape);
+        passed &= check(approximate, 0.0, 0.02 * std::sqrt(double(k)), "gemmInt8 quantization error " + shape);
+
+        // Transposed quantization stores the same values column by column
+        std::vector<uint8_t> columns(k * rna::int8Stride(m));
+        rna::quantizeColumns(columns.data(), rna::int8Stride(m), A.data(), m, k, scale);
+
+        size_t mismatches = 0;
+        for (size_t i(0) ; i < m ; i++)
+        {
+            for (size_t p(0) ; p < k ; p++)
+                mismatches += columns[p*rna::int8Stride(m) + i] != quantized[i*stride + p];
+        }
+
+        passed &= check(mismatches, 0, 0.0, "quantizeColumns " + shape);
+    }
+
+    return passed;
+}
+
+bool philox()
+{
+    bool passed = true;
+
+    // Known answers of Philox4x32-10 from the Random123 distribution
+    const uint32_t vectors[][10] =
+    {
+        {0x00000000, 0x00000000, 0x00000000, 0x00000000,  0x00000000, 0x00000000,  0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,  0xffffffff, 0xffffffff,  0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+        {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,  0xa4093822, 0x299f31d0,  0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}
+    };
+
+    for (const auto& v: vectors)
+    {
+        uint32_t counter[4] = {v[0], v[1], v[2], v[3]};
+        const uint32_t key[2] = {v[4], v[5]};
+
+        rna::philox(counter, key);
+
+        for (size_t i(0) ; i < 4 ; i++)
+            passed &= check(counter[i], v[6+i], 0.0, "philox word " + std::to_string(i));
+    }
+
+    return passed;
+}
+
+
+bool activations()
+{
+    bool passed = true;
+
+    // Magnitudes from where 1 - 2/(exp(2x)+1) and exp(x) - 1 cancel up to where exp saturates, on both sides of 0
+    std::vector<float> pool;
+    for (float magnitude: {1e-7f, 1e-6f, 1e-5f, 1e-4f, 1e-3f, 0.01f, 0.1f, 0.3f, 0.49f, 0.51f, 0.62f, 0.63f, 1.0f, 2.0f, 5.0f, 9.0f, 20.0f, 50.0f, 100.0f})
+    {
+        pool.push_back(magnitude);
+        pool.push_back(-magnitude);
+    }
+
+    std::vector<float> uniform(21);
+    randomize(uniform.data(), uniform.size(), -6.0f, 6.0f);
+    pool.insert(pool.end(), uniform.begin(), uniform.end());
+    pool.push_back(0.0f);
+
+    const float alpha = 0.7f;
+
+    auto tanhReference = [](double _x) { return std::tanh(_x); };
+    auto sigmoidReference = [](double _x) { return 1.0 / (1.0 + std::exp(-_x)); };
+    auto reluReference = [](double _x) { return std::max(_x, 0.0); };
+    auto eluReference = [alpha](double _x) { return _x < 0.0? alpha * std::expm1(_x): _x; };
+
+    // Relative, down to values too small for single precision
+    auto error = [](double _value, double _reference) { return std::abs(_value - _reference) / std::max(std::abs(_reference), 1e-30); };
+
+    // Odd lengths, each value of the pool visiting the vectorized body and the scalar tail
+    for (size_t n: {1, 7, 8, 9, 31, 67})
+    {
+        double forwardError[4] = {0.0, 0.0, 0.0, 0.0}, backwardError[4] = {0.0, 0.0, 0.0, 0.0};
+
+        for (size_t rotation(0) ; rotation < pool.size() ; rotation++)
+        {
+            std::vector<float> x(n), outputGrad(n), y(n), inputGrad(n);
+            for (size_t i(0) ; i < n ; i++)
+                x[i] = pool[(i + rotation) % pool.size()];
+            randomize(outputGrad.data(), n);
+
+            for (int f(0) ; f < 4 ; f++)
+            {
+                switch (f)
+                {
+                    case 0: rna::tanhForward(y.data(), x.data(), n); rna::tanhBackward(inputGrad.data(), y.data(), outputGrad.data(), n); break;
+                    case 1: rna::sigmoidForward(y.data(), x.data(), n); rna::sigmoidBackward(inputGrad.data(), y.data(), outputGrad.data(), n); break;
+                    case 2: rna::reluForward(y.data(), x.data(), n); rna::reluBackward(inputGrad.data(), y.data(), outputGrad.data(), n); break;
+                    default: rna::eluForward(y.data(), x.data(), n, alpha); rna::eluBackward(inputGrad.data(), y.data(), outputGrad.data(), n, alpha);
+                }
+
+                for (size_t i(0) ; i < n ; i++)
+                {
+                    double reference = f == 0? tanhReference(x[i]): f == 1? sigmoidReference(x[i]): f == 2? reluReference(x[i]): eluReference(x[i]);
+
+                    // Derivatives from the computed output, as the layers cache it
+                    double output = y[i];
+                    double derivative = f == 0? 1.0 - output*output: f == 1? output * (1.0 - output): f == 2? (output > 0.0? 1.0: 0.0): (output < 0.0? output + alpha: 1.0);
+
+                    forwardError[f] = std::max(forwardError[f], error(y[i], reference));
+                    backwardError[f] = std::max(backwardError[f], std::abs(inputGrad[i] - derivative * outputGrad[i]));
+                }
+            }
+        }
+
+        const char* names[4] = {"tanh", "sigmoid", "relu", "elu"};
+        for (int f(0) ; f < 4 ; f++)
+        {
+            passed &= check(forwardError[f], 0.0, 1e-6, std::string(names[f]) + "Forward relative error, length " + std::to_string(n));
+            passed &= check(backwardError[f], 0.0, 1e-6, std::string(names[f]) + "Backward, length " + std::to_string(n));
+        }
+    }
+
+    return passed;
+}
+
+}
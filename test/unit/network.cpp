@@ -0,0 +1,289 @@
+#include "unit.h"
+
+#include "RNA/RNA.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace Unit
+{
+
+namespace
+{
+
+// Unique name in the temporary directory of the system
+std::string temporaryPath(const std::string& _extension)
+{
+    const char* directory = nullptr;
+    for (const char* variable: {"TMPDIR", "TEMP", "TMP"})
+        if (!directory)
+            directory = std::getenv(variable);
+
+    #ifdef _WIN32
+    std::string path = directory? directory: ".";
+    #else
+    std::string path = directory? directory: "/tmp";
+    #endif // _WIN32
+
+    return path + "/rna_unit_test_" + std::to_string(std::random_device()()) + "." + _extension;
+}
+
+double difference(const Tensor& _a, const Tensor& _b)
+{
+    if (_a.nElements() != _b.nElements())
+        return 1e9;
+
+    double error = 0.0;
+    for (size_t i(0) ; i < _a.nElements() ; i++)
+        error = std::max(error, double(std::abs(_a[i] - _b[i])));
+
+    return error;
+}
+
+// Every kind of step, with Linear layers followed by fusable activations
+void build(rna::Network& _network)
+{
+    _network.add(new rna::Convolutional({2, 10, 10}, {3, 3}, 4));
+    _network.add(new rna::ReLU());
+    _network.add(new rna::MaxPooling(2, 2));
+    _network.add(new rna::Reshape({64}));
+    _network.add(new rna::Linear(64, 20));
+    _network.add(new rna::Tanh());
+    _network.add(new rna::Dropout(0.0));
+    _network.add(new rna::Linear(20, 20));
+    _network.add(new rna::Sigmoid());
+    _network.add(new rna::Linear(20, 20));
+    _network.add(new rna::ELU(1.0));
+    _network.add(new rna::Linear(20, 3));
+    _network.add(new rna::LogSoftMax());
+}
+
+}
+
+bool checkpointing()
+{
+    bool passed = true;
+
+    rna::Network network;
+    build(network);
+
+    Tensor input({2, 10, 10}), outputGrad({3});
+    randomize(input.data(), input.nElements());
+    randomize(outputGrad.data(), outputGrad.nElements());
+
+    std::vector<Tensor*> params, paramsGrad;
+    network.getParams(params, paramsGrad);
+
+    Tensor output = network.feedForward(input);
+    network.backprop(input, outputGrad);
+
+    std::vector<Tensor> reference;
+    for (Tensor* gradient: paramsGrad)
+    {
+        reference.push_back(*gradient);
+        gradient->fill(0.0);
+    }
+
+    // Dropped outputs are recomputed from the previous checkpoint: same outputs and gradients for every interval,
+    // run twice so that the buffers kept from the previous run do not hide a missing recomputation
+    for (size_t interval(1) ; interval <= 6 ; interval++)
+    {
+        network.setCheckpointing(interval);
+
+        for (size_t run(0) ; run < 2 ; run++)
+        {
+            std::string what = "interval " + std::to_string(interval);
+
+            passed &= check(difference(network.feedForward(input), output), 0.0, 1e-6, what + " output");
+            network.backprop(input, outputGrad);
+
+            for (size_t i(0) ; i < paramsGrad.size() ; i++)
+            {
+                passed &= check(difference(*paramsGrad[i], reference[i]), 0.0, 1e-5, what + " gradient " + std::to_string(i));
+                paramsGrad[i]->fill(0.0);
+            }
+        }
+    }
+
+    // Inference frees the buffers kept for backprop but the output of the last step, training gets them back
+    const size_t layers = 13;
+    network.setTraining(false);
+
+    size_t kept = 0;
+    for (size_t l(0) ; l < layers ; l++)
+        kept += network.getLayer(l)->getInputGrad().nElements() + (l+1 < layers? network.getLayer(l)->getOutput().nElements(): 0);
+
+    passed &= check(kept, 0, 0.0, "buffers kept in inference");
+    passed &= check(difference(network.feedForward(input), output), 0.0, 1e-6, "inference output");
+
+    network.setTraining(true);
+    network.feedForward(input);
+    network.backprop(input, outputGrad);
+
+    for (size_t i(0) ; i < paramsGrad.size() ; i++)
+        passed &= check(difference(*paramsGrad[i], reference[i]), 0.0, 1e-5, "gradient " + std::to_string(i) + " after inference");
+
+    return passed;
+}
+
+bool fusion()
+{
+    bool passed = true;
+
+    rna::Network separate, fused;
+    build(separate);
+    build(fused);
+
+    Tensor params;
+    separate.getParams(params);
+    fused.setParams(params);
+    fused.setFusion(true);
+
+    Tensor input({2, 10, 10}), outputGrad({3});
+    randomize(input.data(), input.nElements());
+    randomize(outputGrad.data(), outputGrad.nElements());
+
+    passed &= check(difference(fused.feedForward(input), separate.feedForward(input)), 0.0, 1e-6, "fused output");
+
+    // Off by default: the Linear layer keeps its output before the activation
+    const Tensor& linearOutput = separate.getLayer(4)->getOutput();
+    const Tensor& tanhOutput = separate.getLayer(5)->getOutput();
+
+    double maxError = 0.0;
+    for (size_t i(0) ; i < linearOutput.nElements() ; i++)
+        maxError = std::max(maxError, double(std::abs(std::tanh(linearOutput[i]) - tanhOutput[i])));
+    passed &= check(maxError, 0.0, 1e-6, "output before the activation");
+
+    // Fused, the Linear layer holds the activated values
+    passed &= check(difference(fused.getLayer(4)->getOutput(), tanhOutput), 0.0, 1e-6, "fused Linear output");
+
+    std::vector<Tensor*> separateParams, separateGrads, fusedParams, fusedGrads;
+    separate.getParams(separateParams, separateGrads);
+    fused.getParams(fusedParams, fusedGrads);
+
+    separate.backprop(input, outputGrad);
+    fused.backprop(input, outputGrad);
+
+    for (size_t i(0) ; i < separateGrads.size() ; i++)
+        passed &= check(difference(*fusedGrads[i], *separateGrads[i]), 0.0, 1e-5, "fused gradient " + std::to_string(i));
+
+    return passed;
+}
+
+bool gradientSharing()
+{
+    bool passed = true;
+
+    const size_t layers = 13;
+
+    rna::Network network, shared, standalone;
+    build(network);
+    build(shared);
+    build(standalone);
+
+    Tensor params;
+    network.getParams(params);
+    shared.setParams(params);
+    standalone.setParams(params);
+    shared.setGradientSharing(true);
+
+    Tensor input({2, 10, 10}), outputGrad({3});
+    randomize(input.data(), input.nElements());
+    randomize(outputGrad.data(), outputGrad.nElements());
+
+    // Reference: the layers of the third network run one by one, each one keeping its own buffers
+    for (size_t l(0) ; l < layers ; l++)
+        standalone.getLayer(l)->feedForward(l? standalone.getLayer(l-1)->getOutput(): input);
+
+    for (size_t l(layers) ; l-- > 0 ; )
+        standalone.getLayer(l)->backprop(l? standalone.getLayer(l-1)->getOutput(): input, (l+1 < layers)? standalone.getLayer(l+1)->getInputGrad(): outputGrad);
+
+    network.feedForward(input);
+    network.backprop(input, outputGrad);
+
+    shared.feedForward(input);
+    shared.backprop(input, outputGrad);
+
+    // Off by default: every layer keeps its input gradient
+    for (size_t l(0) ; l < layers ; l++)
+        passed &= check(difference(network.getLayer(l)->getInputGrad(), standalone.getLayer(l)->getInputGrad()), 0.0, 1e-6, "input gradient " + std::to_string(l));
+
+    // Shared, only the first one is kept, and the parameter gradients do not change
+    passed &= check(difference(shared.getLayer(0)->getInputGrad(), standalone.getLayer(0)->getInputGrad()), 0.0, 1e-6, "shared input gradient 0");
+
+    std::vector<Tensor*> networkParams, networkGrads, sharedParams, sharedGrads;
+    network.getParams(networkParams, networkGrads);
+    shared.getParams(sharedParams, sharedGrads);
+
+    for (size_t i(0) ; i < networkGrads.size() ; i++)
+        passed &= check(difference(*sharedGrads[i], *networkGrads[i]), 0.0, 0.0, "shared gradient " + std::to_string(i));
+
+    return passed;
+}
+
+bool binaryFormat()
+{
+    bool passed = true;
+
+    const std::string textFile = temporaryPath("rna"), binaryFile = textFile + "b";
+
+    rna::Network network;
+    build(network);
+
+    Tensor input({2, 10, 10});
+    randomize(input.data(), input.nElements());
+
+    Tensor output = network.feedForward(input);
+
+    passed &= check(network.saveToFile(textFile), 1, 0.0, "saveToFile (text)");
+    passed &= check(rna::Network::convertToBinary(textFile, binaryFile), 1, 0.0, "convertToBinary");
+
+    // Both formats give back the exact parameters
+    rna::Network fromText, fromBinary;
+    passed &= check(fromText.loadFromFile(textFile), 1, 0.0, "loadFromFile (text)");
+    passed &= check(fromBinary.loadFromFile(binaryFile), 1, 0.0, "loadFromFile (binary)");
+
+    Tensor params, textParams, binaryParams;
+    network.getParams(params);
+    fromText.getParams(textParams);
+    fromBinary.getParams(binaryParams);
+
+    passed &= check(difference(binaryParams, params), 0.0, 0.0, "binary parameters");
+    passed &= check(difference(fromBinary.feedForward(input), output), 0.0, 0.0, "binary output");
+    passed &= check(difference(fromText.feedForward(input), output), 0.0, 1e-5, "text output");
+
+    // Saving the loaded network gives the same file
+    passed &= check(fromBinary.saveToFile(textFile + "2", rna::Network::FileFormat::BINARY), 1, 0.0, "saveToFile (binary)");
+
+    rna::Network reloaded;
+    passed &= check(reloaded.loadFromFile(textFile + "2"), 1, 0.0, "loadFromFile (saved binary)");
+
+    Tensor reloadedParams;
+    reloaded.getParams(reloadedParams);
+    passed &= check(difference(reloadedParams, params), 0.0, 0.0, "saved binary parameters");
+
+    // Unknown versions are refused
+    if (FILE* file = std::fopen(binaryFile.c_str(), "r+b"))
+    {
+        const unsigned char version[4] = {9, 0, 0, 0};
+
+        std::fseek(file, 8, SEEK_SET);
+        std::fwrite(version, 1, sizeof(version), file);
+        std::fclose(file);
+    }
+
+    rna::Network unsupported;
+    passed &= check(unsupported.loadFromFile(binaryFile), 0, 0.0, "loadFromFile (unknown version)");
+
+    std::remove(textFile.c_str());
+    std::remove(binaryFile.c_str());
+    std::remove((textFile + "2").c_str());
+
+    return passed;
+}
+
+}
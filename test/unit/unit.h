@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// Each test compares an optimized routine with a straightforward reference on small, odd shapes
+/// and returns false if any value is out of tolerance
+namespace Unit
+{
+
+bool gemm();
+bool bfloat16();
+bool im2col();
+bool winograd();
+bool fft();
+bool int8();
+bool philox();
+bool activations();
+
+bool checkpointing();
+bool fusion();
+bool gradientSharing();
+bool binaryFormat();
+
+bool convolutionalAlgorithms();
+bool crossEntropy();
+
+// OpenCL kernels, run through the host emulation of clemu.h
+bool linearKernels();
+bool convolutionalKernels();
+bool maxPoolingKernels();
+bool sgdKernel();
+bool rmspropKernel();
+bool adamKernel();
+bool lossKernels();
+bool dropoutKernels();
+
+/// Reports the mismatch and returns false when |_value - _reference| > _tolerance
+bool check(double _value, double _reference, double _tolerance, const std::string& _what);
+
+/// Uniform values in [_min, _max] from a fixed seed, so failures are reproducible
+void randomize(float* _values, size_t _n, float _min = -1.0f, float _max = 1.0f);
+
+}